@@ -0,0 +1,35 @@
+/* Core/Inc/asset_chksum.h */
+#ifndef INC_ASSET_CHKSUM_H_
+#define INC_ASSET_CHKSUM_H_
+
+#include "lwip/arch.h"
+
+/* Assets that can be registered */
+#define ASSET_CHKSUM_ASSETS     4
+
+/* Partial sums kept every this many bytes (power of two) */
+#define ASSET_CHKSUM_CHUNK      64
+
+/* Partial sums stored for all assets together: one per chunk, plus one per asset */
+#define ASSET_CHKSUM_SLOTS      40
+
+/**
+ * @brief  Precomputes the chunk sums of a constant asset.
+ * The asset must never move or change: data sent from it is matched by address.
+ * @param  data : Asset (flash or static const)
+ * @param  len  : Its length
+ * @retval 1 if registered, 0 when out of assets or slots
+ */
+uint8_t asset_chksum_register(const void *data, u16_t len);
+
+/**
+ * @brief  Ones-complement sum of len bytes at p, as LWIP_CHKSUM computes it.
+ * Inside a registered asset only the bytes up to the nearest chunk boundaries
+ * are read; anything else is summed in full.
+ * @param  p   : Data
+ * @param  len : Its length
+ * @retval Folded, non-inverted sum
+ */
+u16_t asset_chksum(const void *p, u16_t len);
+
+#endif /* INC_ASSET_CHKSUM_H_ */
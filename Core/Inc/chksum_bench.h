@@ -0,0 +1,22 @@
+/* Core/Inc/chksum_bench.h */
+#ifndef INC_CHKSUM_BENCH_H_
+#define INC_CHKSUM_BENCH_H_
+
+#include "lwip/opt.h"
+
+/* Bytes summed per run (one full-size TCP payload) and runs per timing */
+#define CHKSUM_BENCH_LEN    1460
+#define CHKSUM_BENCH_RUNS   32
+
+/**
+ * @brief  Times the checksum routines, one result line per call.
+ * lwIP's reference versions 1-3 and chksum_m0 over the start of flash, at an
+ * aligned and an odd start; then memcpy + sum against the fused chksum_m0_copy
+ * into a TCP_MSS-sized pbuf. Each line also says whether the sums agree.
+ * Built only with LWIP_CHKSUM_BENCH.
+ * Same contract as the HTTP body generators (start with *cursor = 0).
+ * @retval Length of the line in buf, 0 when done
+ */
+u16_t chksum_bench_render(uint16_t *cursor, char *buf, u16_t size);
+
+#endif /* INC_CHKSUM_BENCH_H_ */
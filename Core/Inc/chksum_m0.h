@@ -0,0 +1,27 @@
+/* Core/Inc/chksum_m0.h */
+#ifndef INC_CHKSUM_M0_H_
+#define INC_CHKSUM_M0_H_
+
+/* Included from lwipopts.h (before lwIP's own types exist): stdint only */
+#include <stdint.h>
+
+/**
+ * @brief  Internet checksum, as LWIP_CHKSUM: 16 bytes per step on Cortex-M0+.
+ * @param  dataptr : Data, any alignment
+ * @param  len     : Length in bytes (up to 64 KB)
+ * @retval Folded, non-inverted ones-complement sum in host order
+ */
+uint16_t chksum_m0(const void *dataptr, int len);
+
+/**
+ * @brief  memcpy() that returns chksum_m0() of the copied bytes, as LWIP_CHKSUM_COPY.
+ * Source and destination are read and written in one pass when they share
+ * their alignment within a word; otherwise it copies, then sums.
+ * @param  dst : Destination
+ * @param  src : Source
+ * @param  len : Length in bytes
+ * @retval Sum of the copied bytes
+ */
+uint16_t chksum_m0_copy(void *dst, const void *src, uint16_t len);
+
+#endif /* INC_CHKSUM_M0_H_ */
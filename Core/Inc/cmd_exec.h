@@ -0,0 +1,85 @@
+/* Core/Inc/cmd_exec.h */
+#ifndef INC_CMD_EXEC_H_
+#define INC_CMD_EXEC_H_
+
+#include "lwip/arch.h"
+
+/* Max commands in one POST /api/batch request */
+#define CMD_BATCH_MAX   8
+
+/* GPIO actions shared by every command transport (HTTP, WebSocket, ...) */
+typedef enum {
+    CMD_NONE = 0,
+    CMD_ON,
+    CMD_OFF
+} cmd_action_t;
+
+/* Longest "ms" hold a queued step may ask for */
+#define CMD_HOLD_MAX_MS 60000
+
+/* One validated command: which output, what to do with it */
+typedef struct {
+    uint8_t output;         // Index into the output table
+    cmd_action_t action;
+    uint16_t hold_ms;       // Queued jobs only: wait this long before the next step
+} cmd_item_t;
+
+/**
+ * @brief  Extracts the action from a JSON command such as {"cmd":"ON"}.
+ * The buffer does not need to be NUL-terminated.
+ * @param  buf : Request body (or whole request)
+ * @param  len : Number of valid bytes in buf
+ * @retval CMD_ON, CMD_OFF, or CMD_NONE when no known command is present
+ */
+cmd_action_t cmd_parse(const char *buf, u16_t len);
+
+/**
+ * @brief  Drives the LED for an action and notifies SSE subscribers.
+ * @param  action : Action returned by cmd_parse()
+ */
+void cmd_execute(cmd_action_t action);
+
+/**
+ * @brief  Parses and validates a batch such as
+ *         {"cmds":[{"out":"led","cmd":"ON","ms":500},{"cmd":"OFF"}]}
+ * "out" defaults to "led", "ms" (queued jobs only) to 0. Nothing is applied here.
+ * @param  buf   : Request body (not NUL-terminated)
+ * @param  len   : Length of buf
+ * @param  items : Output array, CMD_BATCH_MAX entries
+ * @retval Number of commands (> 0), 0 if there is no command array,
+ *         or -(i + 1) when entry i is invalid
+ */
+int cmd_batch_parse(const char *buf, u16_t len, cmd_item_t *items);
+
+/**
+ * @brief  Applies validated commands together.
+ * All pins of one GPIO port switch in a single BSRR write; a later command
+ * for the same pin overrides an earlier one.
+ * @param  items : Commands from cmd_batch_parse()
+ * @param  count : Number of commands
+ */
+void cmd_batch_execute(const cmd_item_t *items, uint8_t count);
+
+/**
+ * @brief  Number of addressable outputs (valid cmd_item_t.output values).
+ */
+uint8_t cmd_output_count(void);
+
+/**
+ * @brief  Current level of every output as a bitmask (bit i = output i).
+ */
+uint16_t cmd_output_states(void);
+
+/**
+ * @brief  Current LED state as JSON text for acknowledgements and events.
+ * @retval "{\"led\":\"ON\"}" or "{\"led\":\"OFF\"}"
+ */
+const char *cmd_led_json(void);
+
+/**
+ * @brief  Current LED state as plain text (for templates and logs).
+ * @retval "ON" or "OFF"
+ */
+const char *cmd_led_state(void);
+
+#endif /* INC_CMD_EXEC_H_ */
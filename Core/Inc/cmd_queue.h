@@ -0,0 +1,44 @@
+/* Core/Inc/cmd_queue.h */
+#ifndef INC_CMD_QUEUE_H_
+#define INC_CMD_QUEUE_H_
+
+#include "cmd_exec.h"
+
+/* Jobs remembered at once (queued, running, or finished and still reportable) */
+#define CMD_QUEUE_LEN   4
+
+/* Job life cycle */
+typedef enum {
+    JOB_UNKNOWN = 0,    // Never existed, or its slot has been reused
+    JOB_QUEUED,
+    JOB_RUNNING,
+    JOB_DONE,
+    JOB_FAILED          // No lwIP timeout was left to schedule its next step
+} cmd_job_state_t;
+
+/**
+ * @brief  Queues a command sequence for execution outside the network callbacks.
+ * Steps run one after another from an lwIP timeout; each step waits its
+ * hold_ms before the next one. Jobs run strictly in submission order; one
+ * whose next step cannot be scheduled ends as JOB_FAILED and the next starts.
+ * @param  items : Steps from cmd_batch_parse()
+ * @param  count : Number of steps
+ * @retval Job ID (> 0), or -1 when the queue is full
+ */
+int cmd_queue_submit(const cmd_item_t *items, uint8_t count);
+
+/**
+ * @brief  Looks up a job.
+ * @param  id    : Job ID returned by cmd_queue_submit()
+ * @param  step  : Out, steps already executed (may be NULL)
+ * @param  steps : Out, total steps (may be NULL)
+ * @retval Job state, JOB_UNKNOWN if the ID is not (or no longer) tracked
+ */
+cmd_job_state_t cmd_queue_status(uint16_t id, uint8_t *step, uint8_t *steps);
+
+/**
+ * @brief  Lower-case name of a job state for JSON replies.
+ */
+const char *cmd_queue_state_name(cmd_job_state_t state);
+
+#endif /* INC_CMD_QUEUE_H_ */
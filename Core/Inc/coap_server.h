@@ -0,0 +1,45 @@
+/* Core/Inc/coap_server.h */
+#ifndef INC_COAP_SERVER_H_
+#define INC_COAP_SERVER_H_
+
+#include "lwip/arch.h"
+
+#define COAP_PORT           5683
+
+/* Clients that may observe /led at the same time (when full, the slots are
+   replaced round-robin) */
+#define COAP_OBSERVERS      4
+
+/* Notifications to one observer between two CONs, and the longest time
+   without one (RFC 7641 4.5: at least every 24 h) */
+#define COAP_CON_EVERY      8
+#define COAP_CON_PERIOD_MS  (24UL * 60UL * 60UL * 1000UL)
+
+/* Unacknowledged CON notifications, each given COAP_ACK_TIMEOUT_MS, after
+   which the observer is dropped (RFC 7252 ACK_TIMEOUT and MAX_RETRANSMIT) */
+#define COAP_ACK_TIMEOUT_MS 2000
+#define COAP_MAX_RETRANSMIT 4
+
+/* Largest Block2 size we send: 256 bytes (SZX 4) stays well inside a 536-byte MSS */
+#define COAP_BLOCK_SZX      4
+
+/* Largest request accepted (header, token, options and payload) */
+#define COAP_MAX_REQUEST    128
+
+/**
+ * @brief  Binds the CoAP server (RFC 7252) to COAP_PORT.
+ * Resources:
+ *   /.well-known/core  GET       link format
+ *   /led               GET, PUT  "ON"/"OFF" (PUT also takes {"cmd":"ON"}); observable
+ *   /status            GET       same JSON as GET /api/status
+ *   /stats             GET       same JSON as GET /api/stats, block-wise
+ */
+void coap_server_init(void);
+
+/**
+ * @brief  Pushes the current LED state to every /led observer.
+ * Called by the command layer whenever an output changes.
+ */
+void coap_server_notify(void);
+
+#endif /* INC_COAP_SERVER_H_ */
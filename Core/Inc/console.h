@@ -0,0 +1,25 @@
+/* Core/Inc/console.h */
+#ifndef INC_CONSOLE_H_
+#define INC_CONSOLE_H_
+
+#include "lwip/arch.h"
+
+/* Largest piece console_dump() takes from a renderer */
+#define CONSOLE_DUMP_CHUNK  128
+
+/* Piece-by-piece renderer, same contract as the HTTP body generators */
+typedef u16_t (*console_render_fn)(uint16_t *cursor, char *buf, u16_t size);
+
+/**
+ * @brief  Handles single-key commands typed on the debug UART (USART2).
+ * Non-blocking: call it from the main loop. Press 'h' for the command list.
+ */
+void console_poll(void);
+
+/**
+ * @brief  Writes everything a renderer produces to the UART, one piece per line.
+ * @param  render : Renderer to drain (started at cursor 0)
+ */
+void console_dump(console_render_fn render);
+
+#endif /* INC_CONSOLE_H_ */
@@ -89,12 +89,23 @@ typedef struct
   uint16_t LinkStatus;
   uint16_t transmitLength;
   uint16_t NextPacketPtr;
+  uint16_t RxFramePtr;      /* First frame byte of the packet being read (past its status vector) */
   uint32_t startTime;
   uint32_t duration;
   uint16_t retries;
   ENC_RxFrameInfos RxFrameInfos;
 } ENC_HandleTypeDef;
 
+/**
+ * @brief  One in-place edit of a frame sent with enc_reply_from_rx()
+ */
+typedef struct
+{
+  uint16_t offset;          /* From the start of the frame */
+  const uint8_t *data;
+  uint16_t len;
+} ENC_PatchTypeDef;
+
 /* Exported constants --------------------------------------------------------*/
 /* Size of the Ethernet header */
 #define ETH_HDRLEN      14   /* Minimum size: 2*6 + 2 */
@@ -389,6 +400,9 @@ typedef struct
 /* maximum transfer unit */
 #define CONFIG_NET_ETH_MTU 1500
 
+/* Packet memory kept for pre-loaded payload (frame cache), between RX ring and TX buffer */
+#define ENC_CACHE_SIZE    2048
+
 /* Packet Control Bits Definitions ******************************************/
 #define PKTCTRL_POVERRIDE (1 << 0)  /* Bit 0:  Per Packet Override */
 #define PKTCTRL_PCRCEN    (1 << 1)  /* Bit 1:  Per Packet CRC Enable */
@@ -440,6 +454,12 @@ uint8_t enc_packet_receive_status(ENC_HandleTypeDef *handle);
 uint16_t enc_get_packet_length(ENC_HandleTypeDef *handle);
 void enc_rd_packet_payload(ENC_HandleTypeDef *handle, uint8_t *buffer, uint16_t len);
 void enc_read_packet_end(ENC_HandleTypeDef *handle);
+int8_t enc_reply_from_rx(ENC_HandleTypeDef *handle, uint16_t len, const ENC_PatchTypeDef *patch, uint8_t count);
+int8_t enc_cache_write(ENC_HandleTypeDef *handle, uint16_t offset, const void *data, uint16_t len);
+int8_t enc_tx_from_cache(ENC_HandleTypeDef *handle, uint16_t offset, uint16_t frame_offset, uint16_t len);
+int8_t enc_scratch_write(ENC_HandleTypeDef *handle, const void *data, uint16_t len);
+int8_t enc_scratch_read(ENC_HandleTypeDef *handle, void *data, uint16_t len);
+void enc_set_loopback(ENC_HandleTypeDef *handle, bool on);
 
 /* MAC Force Function for main.c */
 void enc_force_mac_hardware(ENC_HandleTypeDef *handle);
@@ -0,0 +1,32 @@
+/* Core/Inc/enc_cache.h */
+#ifndef INC_ENC_CACHE_H_
+#define INC_ENC_CACHE_H_
+
+#include "lwip/arch.h"
+
+/* Static objects that can be registered (the SRAM region is ENC_CACHE_SIZE bytes) */
+#define ENC_CACHE_OBJECTS   4
+
+/* Shorter runs are cheaper to write over SPI than to set up a DMA copy for */
+#define ENC_CACHE_MIN_RUN   32
+
+/**
+ * @brief  Loads a constant object into the ENC28J60 frame cache.
+ * The object must stay at the same address for good (flash or static const):
+ * frames are matched against it by pointer.
+ * @param  data : Object to cache
+ * @param  len  : Its length
+ * @retval Bytes cached from the start of the object (0 when full)
+ */
+u16_t enc_cache_add(const void *data, u16_t len);
+
+/**
+ * @brief  Finds payload bytes that are already in the frame cache.
+ * @param  p      : Start of the bytes to send
+ * @param  len    : Their length
+ * @param  offset : Receives the cache offset of p
+ * @retval Bytes from p on that are cached contiguously (0 if p is not cached)
+ */
+u16_t enc_cache_lookup(const void *p, u16_t len, u16_t *offset);
+
+#endif /* INC_ENC_CACHE_H_ */
@@ -0,0 +1,33 @@
+/* Core/Inc/eth_cmd.h */
+#ifndef INC_ETH_CMD_H_
+#define INC_ETH_CMD_H_
+
+#include "lwip/arch.h"
+
+/* IEEE 802 "local experimental" EtherType 1: frames with it never reach lwIP */
+#define ETH_CMD_TYPE        0x88B5
+
+/* Ethernet header + one command frame (the format of udp_cmd.h) */
+#define ETH_CMD_HDR_LEN     14
+#define ETH_CMD_LEN         (ETH_CMD_HDR_LEN + 8)
+
+/**
+ * @brief  True when a received Ethernet header belongs to the command channel.
+ * @param  hdr : First ETH_CMD_HDR_LEN bytes of the frame
+ */
+static inline uint8_t eth_cmd_match(const uint8_t *hdr)
+{
+    return hdr[12] == (ETH_CMD_TYPE >> 8) && hdr[13] == (ETH_CMD_TYPE & 0xFF);
+}
+
+/**
+ * @brief  Executes a command frame and builds the raw reply frame, if one is wanted.
+ * Runs in the driver receive path, before (and instead of) any pbuf allocation.
+ * @param  frame  : Received frame, at least ETH_CMD_LEN bytes
+ * @param  hwaddr : Our MAC address (source of the reply)
+ * @param  reply  : Receives the reply frame, ETH_CMD_LEN bytes
+ * @retval Length of the reply frame, 0 when none is to be sent
+ */
+u16_t eth_cmd_input(const uint8_t *frame, const uint8_t *hwaddr, uint8_t *reply);
+
+#endif /* INC_ETH_CMD_H_ */
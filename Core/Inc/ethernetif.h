@@ -42,6 +42,10 @@ u32_t sys_now(void);
 
 /* USER CODE BEGIN 1 */
 void ethernet_transmit(void);
+struct pbuf *ethernetif_read_frame(struct netif *netif);
+void ethernetif_hold_frame(struct pbuf *p);
+void ethernetif_release_held(struct netif *netif);
+uint8_t ethernetif_held_pending(void);
 
 /* USER CODE END 1 */
 #endif
@@ -0,0 +1,72 @@
+/* Core/Inc/fw_update.h */
+#ifndef INC_FW_UPDATE_H_
+#define INC_FW_UPDATE_H_
+
+#include "lwip/err.h"
+#include "lwip/pbuf.h"
+
+/* Only built with FW_UPDATE_ENABLE (main.h, off by default): the upload is
+ * not authenticated.
+ *
+ * Flash layout (2 KB pages). fw_update.c exports FW_SLOT_SIZE as fw_app_slot,
+ * which both .ld files check the image against.
+ *   0x08000000  APP      62 KB  running image
+ *   0x0800F800  STAGING  62 KB  upload target
+ *   0x0801F000  META      2 KB  "image staged" record read at boot
+ *   0x0801F800  (spare)   2 KB
+ */
+#define FW_APP_ADDR         0x08000000UL
+#define FW_STAGING_ADDR     0x0800F800UL
+#define FW_META_ADDR        0x0801F000UL
+#define FW_SLOT_SIZE        (62UL * 1024UL)
+
+/* Time between the upload reply and the reset that applies it */
+#define FW_REBOOT_DELAY_MS  1000
+
+/**
+ * @brief  Starts a new upload into the staging area.
+ * Pages are erased lazily as data reaches them. The upload is not
+ * authenticated (lab use only): anyone reaching the HTTP port can flash.
+ * @param  size : Image size in bytes (Content-Length)
+ * @param  crc  : Expected CRC-32 (IEEE 802.3, as computed by zlib/crc32)
+ * @retval ERR_OK, ERR_VAL for a bad size, ERR_INPROGRESS if an upload is running
+ */
+err_t fw_update_begin(u32_t size, u32_t crc);
+
+/**
+ * @brief  Programs the next chunk of the image straight from a pbuf chain.
+ * Returns once the bytes are in flash (up to 7 trailing bytes wait in RAM for
+ * the next double-word), so the caller can tcp_recved() them afterwards.
+ * @param  p      : Received data
+ * @param  offset : First byte of p that belongs to the image
+ * @param  len    : Number of image bytes in p from offset
+ * @retval ERR_OK, ERR_VAL when more than the announced size arrives, ERR_IF on a flash error
+ */
+err_t fw_update_write(const struct pbuf *p, u16_t offset, u16_t len);
+
+/**
+ * @brief  Flushes the tail, checks the CRC of what is in flash and marks the image
+ * for installation. On success a reset is scheduled FW_REBOOT_DELAY_MS later.
+ * @retval ERR_OK, ERR_VAL on a CRC mismatch, ERR_IF on a flash error
+ */
+err_t fw_update_finish(void);
+
+/**
+ * @brief  Cancels a running upload (the staging area is simply left behind).
+ */
+void fw_update_abort(void);
+
+/**
+ * @brief  Bytes of the running upload received so far.
+ */
+u32_t fw_update_received(void);
+
+/**
+ * @brief  Installs a staged image, if one is pending and still verifies.
+ * Call first thing in main(): the copy runs from RAM with interrupts off and
+ * ends with a reset into the new image. Returns only when there is nothing to do.
+ * A power cut during the copy (well under a second) leaves a broken image.
+ */
+void fw_update_boot_check(void);
+
+#endif /* INC_FW_UPDATE_H_ */
@@ -0,0 +1,34 @@
+/* Core/Inc/http_sse.h */
+#ifndef INC_HTTP_SSE_H_
+#define INC_HTTP_SSE_H_
+
+#include "lwip/tcp.h"
+
+/* Max simultaneous /events subscribers (each one holds a TCP PCB open) */
+#define HTTP_SSE_MAX_CLIENTS    2
+
+/* Events queued per subscriber that are still waiting for their ACK */
+#define HTTP_SSE_QUEUE_LEN      4
+
+/* Keep-alive comment interval, in poll ticks (tcp_poll interval 4 = 2s) */
+#define HTTP_SSE_KEEPALIVE_POLLS 8
+
+/**
+ * @brief  Takes over an accepted HTTP connection as a text/event-stream subscriber.
+ * Sends the SSE response headers and keeps the connection open.
+ * The caller must not touch the pcb callbacks after this returns ERR_OK.
+ * @param  tpcb : Connection that requested GET /events
+ * @retval ERR_OK, or ERR_MEM when all subscriber slots are in use
+ */
+err_t http_sse_subscribe(struct tcp_pcb *tpcb);
+
+/**
+ * @brief  Pushes one event to every subscriber.
+ * The payload is rendered once into a single PBUF_RAM and referenced (not copied)
+ * by each subscriber's send queue until the client ACKs it.
+ * @param  event : SSE event name (e.g. "led")
+ * @param  data  : Single-line event data (e.g. JSON)
+ */
+void http_sse_publish(const char *event, const char *data);
+
+#endif /* INC_HTTP_SSE_H_ */
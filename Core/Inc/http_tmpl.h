@@ -0,0 +1,45 @@
+/* Core/Inc/http_tmpl.h */
+#ifndef INC_HTTP_TMPL_H_
+#define INC_HTTP_TMPL_H_
+
+#include "lwip/err.h"
+
+/* Tag handlers that can be registered */
+#define HTTP_TMPL_MAX_TAGS  8
+
+/* Longest tag name, e.g. <!--#uptime--> */
+#define HTTP_TMPL_TAG_MAX   16
+
+/* Writes a tag's current value into buf; returns its length */
+typedef u16_t (*http_tmpl_fn)(char *buf, u16_t size);
+
+/**
+ * @brief  Binds <!--#tag--> markers in templates to a handler.
+ * @param  tag : Tag name without the markup (must stay valid, e.g. a literal)
+ * @param  fn  : Handler called each time the tag is sent
+ * @retval ERR_OK, ERR_MEM when the table is full
+ */
+err_t http_tmpl_register(const char *tag, http_tmpl_fn fn);
+
+/**
+ * @brief  Length of the literal text in front of the next tag marker.
+ * @param  s   : Template text (flash-resident)
+ * @param  len : Bytes left in the template
+ * @retval Bytes that can be sent as-is (len when no marker follows)
+ */
+u16_t http_tmpl_literal(const char *s, u16_t len);
+
+/**
+ * @brief  Expands the marker at the start of s.
+ * Unknown tags expand to nothing; a marker without its closing "-->" is
+ * passed through as text.
+ * @param  s        : Template text, starting at "<!--#"
+ * @param  len      : Bytes left in the template
+ * @param  buf      : Output buffer
+ * @param  size     : Size of buf
+ * @param  consumed : Returns how many template bytes the marker took
+ * @retval Bytes written to buf
+ */
+u16_t http_tmpl_render(const char *s, u16_t len, char *buf, u16_t size, u16_t *consumed);
+
+#endif /* INC_HTTP_TMPL_H_ */
@@ -0,0 +1,29 @@
+/* Core/Inc/http_ws.h */
+#ifndef INC_HTTP_WS_H_
+#define INC_HTTP_WS_H_
+
+#include "lwip/tcp.h"
+
+/* Max simultaneous WebSocket connections (each one holds a TCP PCB open) */
+#define HTTP_WS_MAX_CLIENTS     2
+
+/* Largest reassembled data message; bigger ones are refused with 1009 */
+#define HTTP_WS_MAX_MSG         128
+
+/* Idle time before we ping the peer, in poll ticks (tcp_poll interval 4 = 2s) */
+#define HTTP_WS_PING_POLLS      15
+
+/**
+ * @brief  Completes the RFC 6455 opening handshake and takes over the connection.
+ * Requires "Upgrade: websocket" and "Sec-WebSocket-Version: 13" (header names
+ * in any case), then answers 101 Switching Protocols with Sec-WebSocket-Accept
+ * computed from the request's Sec-WebSocket-Key. The caller must not touch the
+ * pcb callbacks after this returns ERR_OK.
+ * @param  tpcb : Connection that requested GET /ws
+ * @param  req  : Raw request headers (not NUL-terminated)
+ * @param  len  : Length of req
+ * @retval ERR_OK, ERR_VAL on a malformed handshake, ERR_MEM when all slots are busy
+ */
+err_t http_ws_upgrade(struct tcp_pcb *tpcb, const char *req, u16_t len);
+
+#endif /* INC_HTTP_WS_H_ */
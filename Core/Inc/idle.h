@@ -0,0 +1,50 @@
+/* Core/Inc/idle.h */
+#ifndef INC_IDLE_H_
+#define INC_IDLE_H_
+
+#include "main.h"
+
+/*
+ * 1 when the ENC28J60 INT output is wired to IDLE_ENC_INT_Pin (open drain,
+ * active low). The CPU then sleeps until the next lwIP timeout or a frame;
+ * without it, EPKTCNT is polled every IDLE_POLL_US while asleep.
+ */
+#define IDLE_ENC_INT            0
+#define IDLE_ENC_INT_Pin        GPIO_PIN_4
+#define IDLE_ENC_INT_GPIO_Port  GPIOA
+
+/* Receive latency bound when the ENC28J60 has to be polled */
+#define IDLE_POLL_US            1000U
+
+/* Longest sleep, so the main loop still runs its own periodic checks */
+#define IDLE_MAX_SLEEP_MS       250U
+
+/* Shorter sleeps are not worth stopping the tick for */
+#define IDLE_MIN_SLEEP_MS       2U
+
+/**
+ * @brief  Sets up the wake-up sources: TIM2 compare 1, USART2 receive and,
+ * with IDLE_ENC_INT, the ENC28J60 INT line. Run after metrics_init().
+ */
+void idle_init(void);
+
+/**
+ * @brief  Sleeps until the next lwIP timeout is due (sys_timeouts_sleeptime()),
+ * a frame arrives or a key is typed on the console.
+ * Returns at once when any of them is already pending. SysTick is stopped
+ * meanwhile and HAL_GetTick() is brought forward by the time slept.
+ */
+void idle_sleep(void);
+
+/**
+ * @brief  TIM2 compare 1 interrupt: end of a sleep slice.
+ */
+void idle_tim_irq(void);
+
+/**
+ * @brief  USART2 interrupt: a console key woke the CPU.
+ * The byte is left in RDR for console_poll().
+ */
+void idle_uart_irq(void);
+
+#endif /* INC_IDLE_H_ */
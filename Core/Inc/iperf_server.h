@@ -0,0 +1,28 @@
+/* Core/Inc/iperf_server.h */
+#ifndef INC_IPERF_SERVER_H_
+#define INC_IPERF_SERVER_H_
+
+#include "lwip/arch.h"
+
+/* Rendered result, NUL included, with "aborted_remote",
+   255.255.255.255:65535 and 10-digit figures */
+#define IPERF_SERVER_RENDER_MAX 114
+
+/**
+ * @brief  Starts the lwiperf TCP server on port 5001 (iperf2 protocol), so
+ * "iperf -c <board> [-r|-d]" on a PC measures this stack end to end.
+ * Every finished or aborted test is printed on the UART as one line.
+ * @retval 0 on success, -1 when no pcb or memory was left for the listener
+ */
+int iperf_server_init(void);
+
+/**
+ * @brief  Renders the last test result as compact JSON:
+ *   {"result":"server","remote":"a.b.c.d:port","bytes","ms","kbps"}
+ * "result" is "none" until a test has finished.
+ * Same contract as the HTTP body generators (start with *cursor = 0).
+ * @retval Length of the piece in buf, 0 when done
+ */
+u16_t iperf_server_render(uint16_t *cursor, char *buf, u16_t size);
+
+#endif /* INC_IPERF_SERVER_H_ */
@@ -0,0 +1,11 @@
+/* Core/Inc/lwip_hooks.h */
+#ifndef INC_LWIP_HOOKS_H_
+#define INC_LWIP_HOOKS_H_
+
+/* Included by the lwIP sources that provide hooks (LWIP_HOOK_FILENAME) */
+
+#include "asset_chksum.h"
+
+#define LWIP_HOOK_TCP_NOCOPY_CHKSUM(dataptr, len)   asset_chksum(dataptr, len)
+
+#endif /* INC_LWIP_HOOKS_H_ */
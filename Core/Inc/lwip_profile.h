@@ -0,0 +1,100 @@
+/* Core/Inc/lwip_profile.h */
+#ifndef INC_LWIP_PROFILE_H_
+#define INC_LWIP_PROFILE_H_
+
+/*
+ * Named lwIP memory profiles for the 36 KB STM32G071 (included by lwipopts.h).
+ *
+ * Every pool, the PBUF_POOL and the mem_malloc() size classes (lwippools.h)
+ * are static, so a profile fixes lwIP's whole RAM footprint at build time.
+ * That memory is placed in .bss.lwip_ram (see cc.h), and the linker script
+ * fails the link when it is larger than LWIP_PROFILE_RAM_BUDGET or when data,
+ * bss, heap and stack together overflow RAM. 'p' on the console prints the
+ * breakdown per pool.
+ *
+ * Estimated lwIP RAM and what each profile is for:
+ *   BALANCED  ~16.8 KB  The long-standing settings: MSS 536, 4-MSS window,
+ *                       5 pcbs, 16 pool buffers
+ *   CONTROL   ~9.7 KB   Low-latency control: small windows and few buffers,
+ *                       so little queues up in front of a command
+ *   BULK      ~16.1 KB  Throughput: MSS 1460, full-frame pool buffers;
+ *                       two segments in flight per direction
+ *   CONNS     ~16.6 KB  Many clients: 10 pcbs, http_state slots and segments
+ *                       for each, 2-MSS windows
+ */
+#define LWIP_PROFILE_BALANCED   0
+#define LWIP_PROFILE_CONTROL    1
+#define LWIP_PROFILE_BULK       2
+#define LWIP_PROFILE_CONNS      3
+
+#ifndef LWIP_PROFILE
+#define LWIP_PROFILE            LWIP_PROFILE_BALANCED
+#endif
+
+/*
+ * LWIP_PROFILE_POOL_SMALL/_MID/_SEG: slots in the 80 byte, 256 byte and
+ * segment-sized mem_malloc() classes, sized for the peak of each profile:
+ *   SMALL  one http_state/lwiperf state per TCP pcb, struct dhcp, two
+ *          replies in transit, and a header per no-copy segment in flight
+ *          (TCP_SND_BUF / TCP_MSS + 1 per sending connection)
+ *   MID    one SSE event per subscriber plus a DNS query or CoAP reply
+ *   SEG    copied segments, CoAP blocks, a coalesced HTTP request
+ * An empty class falls through to the next bigger one, so running short of
+ * small slots costs RAM efficiency, not requests. The "max" of POOL_80,
+ * POOL_256 and POOL_<seg> in /api/stats is the peak to check these against.
+ * LWIP_PROFILE_RAM_BUDGET: bytes the linker allows for .bss.lwip_ram
+ * (a plain number: the linker script reads it as a symbol).
+ */
+#if LWIP_PROFILE == LWIP_PROFILE_BALANCED
+
+#define LWIP_PROFILE_NAME           "balanced"
+#define LWIP_PROFILE_RAM_BUDGET     17408
+#define LWIP_PROFILE_POOL_SMALL     20  // 5 states + 3 + 3 headers x 4 senders
+#define LWIP_PROFILE_POOL_MID       4
+#define LWIP_PROFILE_POOL_SEG       2
+
+#elif LWIP_PROFILE == LWIP_PROFILE_CONTROL
+
+#define LWIP_PROFILE_NAME           "control"
+#define LWIP_PROFILE_RAM_BUDGET     10240
+#define LWIP_PROFILE_POOL_SMALL     16  // 4 states + 3 + 3 headers x 3 senders
+#define LWIP_PROFILE_POOL_MID       2
+#define LWIP_PROFILE_POOL_SEG       1
+#define TCP_WND                     (2 * TCP_MSS)
+#define MEMP_NUM_TCP_PCB            4
+#define MEMP_NUM_TCP_PCB_LISTEN     4
+#define MEMP_NUM_TCP_SEG            12
+#define MEMP_NUM_PBUF               12
+#define PBUF_POOL_SIZE              8
+
+#elif LWIP_PROFILE == LWIP_PROFILE_BULK
+
+#define LWIP_PROFILE_NAME           "bulk"
+#define LWIP_PROFILE_RAM_BUDGET     18432
+#define LWIP_PROFILE_POOL_SMALL     16  // 4 states + 3 + 3 headers x 3 senders
+#define LWIP_PROFILE_POOL_MID       2
+#define LWIP_PROFILE_POOL_SEG       2
+#define TCP_MSS                     1460
+#define TCP_WND                     (2 * TCP_MSS)
+#define MEMP_NUM_TCP_PCB            4
+#define MEMP_NUM_TCP_PCB_LISTEN     4
+#define PBUF_POOL_SIZE              6
+
+#elif LWIP_PROFILE == LWIP_PROFILE_CONNS
+
+#define LWIP_PROFILE_NAME           "conns"
+#define LWIP_PROFILE_RAM_BUDGET     17408
+#define LWIP_PROFILE_POOL_SMALL     31  // 10 states + 3 + 3 headers x 6 senders
+#define LWIP_PROFILE_POOL_MID       4
+#define LWIP_PROFILE_POOL_SEG       2
+#define TCP_WND                     (2 * TCP_MSS)
+#define MEMP_NUM_TCP_PCB            10
+#define MEMP_NUM_TCP_SEG            32
+#define MEMP_NUM_PBUF               24
+#define PBUF_POOL_SIZE              12
+
+#else
+#error "LWIP_PROFILE: unknown profile"
+#endif
+
+#endif /* INC_LWIP_PROFILE_H_ */
@@ -61,14 +61,6 @@
 #define LWIP_ETHERNET 1
 /*----- Value in opt.h for LWIP_DNS_SECURE: (LWIP_DNS_SECURE_RAND_XID | LWIP_DNS_SECURE_NO_MULTIPLE_OUTSTANDING | LWIP_DNS_SECURE_RAND_SRC_PORT) -*/
 #define LWIP_DNS_SECURE 7
-/*----- Value in opt.h for TCP_SND_QUEUELEN: (4*TCP_SND_BUF + (TCP_MSS - 1))/TCP_MSS -----*/
-#define TCP_SND_QUEUELEN 9
-/*----- Value in opt.h for TCP_SNDLOWAT: LWIP_MIN(LWIP_MAX(((TCP_SND_BUF)/2), (2 * TCP_MSS) + 1), (TCP_SND_BUF) - 1) -*/
-#define TCP_SNDLOWAT 1071
-/*----- Value in opt.h for TCP_SNDQUEUELOWAT: LWIP_MAX(TCP_SND_QUEUELEN)/2, 5) -*/
-#define TCP_SNDQUEUELOWAT 5
-/*----- Value in opt.h for TCP_WND_UPDATE_THRESHOLD: LWIP_MIN(TCP_WND/4, TCP_MSS*4) -----*/
-#define TCP_WND_UPDATE_THRESHOLD 536
 /*----- Default Value for LWIP_NETIF_LINK_CALLBACK: 0 ---*/
 #define LWIP_NETIF_LINK_CALLBACK 1
 /*----- Value in opt.h for LWIP_NETCONN: 1 -----*/
@@ -78,7 +70,7 @@
 /*----- Value in opt.h for RECV_BUFSIZE_DEFAULT: INT_MAX -----*/
 #define RECV_BUFSIZE_DEFAULT 2000000000
 /*----- Value in opt.h for LWIP_STATS: 1 -----*/
-#define LWIP_STATS 0
+#define LWIP_STATS 1
 /*----- Value in opt.h for CHECKSUM_GEN_IP: 1 -----*/
 #define CHECKSUM_GEN_IP 1
 /*----- Value in opt.h for CHECKSUM_GEN_UDP: 1 -----*/
@@ -101,6 +93,52 @@
 #define CHECKSUM_CHECK_ICMP6 0
 /*-----------------------------------------------------------------------------*/
 /* USER CODE BEGIN 1 */
+/* Memory profile: pool sizes, windows and MSS (LWIP_PROFILE, lwip_profile.h).
+ * TCP_SND_QUEUELEN, TCP_SNDLOWAT, TCP_SNDQUEUELOWAT and TCP_WND_UPDATE_THRESHOLD
+ * keep their opt.h formulas, so they follow the profile's MSS and buffers */
+#include "lwip_profile.h"
+
+/* Application timeouts on top of the stack's own: cmd_queue step timer,
+ * mem_watch stack scan and, when built, the fw_update reboot */
+#define MEMP_NUM_SYS_TIMEOUT (LWIP_NUM_SYS_TIMEOUT_INTERNAL + 2 + FW_UPDATE_ENABLE)
+
+/* Statistics exported by net_stats: heap, pools, link, ARP and TCP only */
+#define IP_STATS 0
+#define ICMP_STATS 0
+#define UDP_STATS 0
+#define IGMP_STATS 0
+#define IPFRAG_STATS 0
+
+/* TCP data is summed once when queued, not on every (re)transmission.
+ * Constant assets use sums precomputed by asset_chksum (see lwip_hooks.h) */
+#define LWIP_CHECKSUM_ON_COPY 1
+#define LWIP_HOOK_FILENAME "lwip_hooks.h"
+
+/* Cortex-M0+ checksum kernels. Build with -DLWIP_CHKSUM_BENCH=1 to get
+ * 'k' on the console, which times them against lwIP's reference versions;
+ * tests/chksum_test checks them on the host */
+#include "chksum_m0.h"
+#define LWIP_CHKSUM chksum_m0
+#define LWIP_CHKSUM_COPY(dst, src, len) chksum_m0_copy(dst, src, len)
+
+/* Segments find their pcb through a hash on the connection, so demux cost
+ * stays flat as keep-alive and SSE clients add pcbs */
+#define LWIP_TCP_PCB_HASH 1
+#define TCP_PCB_HASH_SIZE 8
+
+/* Timeouts live on a timer wheel: adding, cancelling and checking them does
+ * not walk a list, and idle_sleep() asks it how long the CPU may sleep */
+#define LWIP_TIMERS_WHEEL 1
+
+/* mem_malloc() hands out slots of fixed size classes (lwippools.h) instead of
+ * first-fit on the 1600-byte heap: O(1), and days of uptime cannot break the
+ * memory into holes too small for a segment. net_stats reports the largest
+ * free slot and the bytes lost to rounding up to a class. MEM_SIZE is not
+ * used in this mode: the classes' slot counts (lwip_profile.h) are the heap */
+#define MEM_USE_POOLS 1
+#define MEMP_USE_CUSTOM_POOLS 1
+#define MEM_USE_POOLS_TRY_BIGGER_POOL 1
+#define MEM_STATS 1
 
 /* USER CODE END 1 */
 
@@ -0,0 +1,29 @@
+/* Core/Inc/lwippools.h */
+
+/*
+ * Size classes behind mem_malloc() (MEM_USE_POOLS in lwipopts.h).
+ *
+ * Included several times by lwip/priv/memp_std.h: no include guard. Sizes
+ * are user bytes, smallest first; mem_malloc() takes the first class that
+ * fits and, when it is empty, the next bigger one. Slot counts come from
+ * the memory profile (lwip_profile.h). Without TCP options (PBUF_RAM sizes
+ * are aligned struct pbuf + headroom + payload):
+ *   80   TCP headers for no-copy segments (72) and ACK/SYN/RST (76), ARP
+ *        requests (60), UDP and CoAP acks, http_state (76), struct dhcp
+ *        (52), lwiperf sessions (72)
+ *   256  SSE events, DNS queries, short copied TCP writes
+ *   seg  Full-MSS copied segments (72 + 536; tcp_write() with COPY usually
+ *        allocates a whole MSS), DHCP messages (60 + 548), CoAP block
+ *        responses, and an HTTP request coalesced by http_server.c
+ *        (16 + HTTP_REQ_MAX = 1040); 1532 (72 + 1460) with the 1460 MSS
+ */
+
+LWIP_MALLOC_MEMPOOL_START
+LWIP_MALLOC_MEMPOOL(LWIP_PROFILE_POOL_SMALL, 80)
+LWIP_MALLOC_MEMPOOL(LWIP_PROFILE_POOL_MID, 256)
+#if TCP_MSS > 536
+LWIP_MALLOC_MEMPOOL(LWIP_PROFILE_POOL_SEG, 1532)
+#else
+LWIP_MALLOC_MEMPOOL(LWIP_PROFILE_POOL_SEG, 1040)
+#endif
+LWIP_MALLOC_MEMPOOL_END
@@ -82,6 +82,14 @@ void Error_Handler(void);
 // --- Test Macro to check system sanity ---
 #define TEST_MODE_LED 0
 
+// --- Firmware update over HTTP (POST /api/firmware, see fw_update.h) ---
+// 0 = Not built: the whole 128 KB of flash is the application
+// 1 = Built: unauthenticated, anyone reaching port 80 can reflash the board.
+//     Lab networks only; the image must then fit the 62 KB slot
+#ifndef FW_UPDATE_ENABLE
+#define FW_UPDATE_ENABLE 0
+#endif
+
 /* USER CODE END Private defines */
 
 #ifdef __cplusplus
@@ -0,0 +1,18 @@
+/* Core/Inc/mem_budget.h */
+#ifndef INC_MEM_BUDGET_H_
+#define INC_MEM_BUDGET_H_
+
+#include "lwip/arch.h"
+
+/**
+ * @brief  Renders the lwIP memory profile: settings, then the RAM taken by
+ * each pool and the total against LWIP_PROFILE_RAM_BUDGET. One line per call,
+ * same contract as the HTTP body generators.
+ * @param  cursor : Render position, 0 on the first call
+ * @param  buf    : Output buffer
+ * @param  size   : Size of buf
+ * @retval Bytes written, 0 when done
+ */
+u16_t mem_budget_render(uint16_t *cursor, char *buf, u16_t size);
+
+#endif /* INC_MEM_BUDGET_H_ */
@@ -0,0 +1,42 @@
+/* Core/Inc/mem_watch.h */
+#ifndef INC_MEM_WATCH_H_
+#define INC_MEM_WATCH_H_
+
+#include "lwip/arch.h"
+
+/* Bytes left unpainted below the stack pointer of mem_watch_paint() */
+#define MEM_WATCH_GUARD     64
+
+/* How often the painted area is scanned for the deepest stack use */
+#define MEM_WATCH_SCAN_MS   1000
+
+/* Longest rendered piece, NUL included: the "stack" piece, whose figures
+   cannot pass five digits with 36 KB of RAM */
+#define MEM_WATCH_RENDER_MAX 54
+
+/**
+ * @brief  Fills the free RAM between the newlib heap and the stack with a
+ * pattern, so the deepest stack use can be found later.
+ * Call first thing in main(), before anything deep runs or malloc()s.
+ */
+void mem_watch_paint(void);
+
+/**
+ * @brief  Starts the periodic stack scan (a lwIP timeout): run after lwip_init().
+ */
+void mem_watch_init(void);
+
+/**
+ * @brief  Renders the next piece of the RAM high-water report as compact JSON:
+ *   {"stack":{"reserved","used","gap"},"sbrk":{"used","limit"},
+ *    "lwip":{"heap":[max,avail],"pools":{"TCP_PCB":[max,avail],...}}}
+ * "used" is the deepest the MSP stack has been, "gap" the RAM never touched
+ * between the heap and that point. Pools give their high-water mark and size.
+ * @param  cursor : Render position, updated on return
+ * @param  buf    : Output buffer (not NUL-terminated on return)
+ * @param  size   : Size of buf; pieces are cut short below MEM_WATCH_RENDER_MAX
+ * @retval Number of bytes written to buf, 0 once everything was rendered
+ */
+u16_t mem_watch_render(uint16_t *cursor, char *buf, u16_t size);
+
+#endif /* INC_MEM_WATCH_H_ */
@@ -0,0 +1,75 @@
+/* Core/Inc/metrics.h */
+#ifndef INC_METRICS_H_
+#define INC_METRICS_H_
+
+#include "main.h"
+#include "lwip/arch.h"
+
+/* Histogram upper bounds in microseconds; one more bucket catches +Inf */
+#define METRICS_BUCKETS     12
+
+/* Longest rendered piece, NUL included: the # HELP line of
+   http_deadline_aborts_total (bucket lines stay under 80) */
+#define METRICS_RENDER_MAX  90
+
+/* Latency series, each one a fixed-bucket histogram */
+typedef enum {
+    METRIC_HTTP_FIRST_BYTE = 0, // accept -> first byte received
+    METRIC_HTTP_RECEIVE,        // first byte -> request complete
+    METRIC_HTTP_HANDLER,        // request complete -> response queued (parse + route)
+    METRIC_HTTP_ACK_WAIT,       // response queued -> last byte ACKed
+    METRIC_HTTP_TOTAL,          // accept -> closed
+    METRIC_ETH_TX,              // low_level_output(): flatten + SPI write + TX start
+    METRIC_ETH_RX,              // low_level_input(): SPI read of one frame
+    METRIC_COUNT
+} metric_id_t;
+
+/* Event counters, exported after the histograms */
+typedef enum {
+    METRIC_CNT_DEADLINE_FIRST_BYTE = 0, // No request byte within HTTP_FIRST_BYTE_MS
+    METRIC_CNT_DEADLINE_HEADERS,        // Headers not complete within HTTP_HEADERS_MS
+    METRIC_CNT_DEADLINE_BODY_RATE,      // Body slower than HTTP_BODY_MIN_BPS
+    METRIC_CNT_COUNT
+} metric_counter_t;
+
+/**
+ * @brief  Starts TIM2 as a free-running 32-bit microsecond counter.
+ * Must run after SystemClock_Config(). No interrupt is used; the counter
+ * simply wraps every ~71 minutes, which unsigned subtraction handles.
+ */
+void metrics_init(void);
+
+/**
+ * @brief  Current timestamp in microseconds (wraps at 2^32).
+ */
+static inline uint32_t metrics_now_us(void)
+{
+    return TIM2->CNT;
+}
+
+/**
+ * @brief  Adds one sample to a latency histogram.
+ * @param  id : Series to update
+ * @param  us : Duration in microseconds
+ */
+void metrics_observe(metric_id_t id, uint32_t us);
+
+/**
+ * @brief  Increments an event counter.
+ * @param  id : Counter to update
+ */
+void metrics_count(metric_counter_t id);
+
+/**
+ * @brief  Renders the next piece of the Prometheus text exposition.
+ * Call repeatedly with the same cursor (start at 0) until it returns 0.
+ * The cursor only advances on success, so a piece that could not be sent
+ * is rendered again by restoring the previous cursor value.
+ * @param  cursor : Render position, updated on return
+ * @param  buf    : Output buffer (not NUL-terminated on return)
+ * @param  size   : Size of buf; pieces are cut short below METRICS_RENDER_MAX
+ * @retval Number of bytes written to buf, 0 once everything was rendered
+ */
+u16_t metrics_render(uint16_t *cursor, char *buf, u16_t size);
+
+#endif /* INC_METRICS_H_ */
@@ -0,0 +1,27 @@
+/* Core/Inc/net_stats.h */
+#ifndef INC_NET_STATS_H_
+#define INC_NET_STATS_H_
+
+#include "lwip/arch.h"
+
+/* Longest rendered piece, NUL included: "link" with five-digit counters
+   (STAT_COUNTER is u16_t while LWIP_STATS_LARGE is off) */
+#define NET_STATS_RENDER_MAX    72
+
+/**
+ * @brief  Renders the next piece of the lwIP statistics as compact JSON.
+ * Call repeatedly with the same cursor (start at 0) until it returns 0.
+ * Memory entries are arrays [used, max, avail, err]; "max" is the high-water
+ * mark since boot:
+ *   {"heap":[..],"pools":{"TCP_PCB":[..],...},
+ *    "heap_classes":{"largest","held","waste"} (MEM_USE_POOLS only),
+ *    "link":{"rx","tx","drop","memerr","err"},"arp":{"rx","tx","drop"},
+ *    "tcp":{"rx","tx","drop","memerr","rexmit","ooseq"}}
+ * @param  cursor : Render position, updated on return
+ * @param  buf    : Output buffer (not NUL-terminated on return)
+ * @param  size   : Size of buf; pieces are cut short below NET_STATS_RENDER_MAX
+ * @retval Number of bytes written to buf, 0 once everything was rendered
+ */
+u16_t net_stats_render(uint16_t *cursor, char *buf, u16_t size);
+
+#endif /* INC_NET_STATS_H_ */
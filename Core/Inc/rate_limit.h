@@ -0,0 +1,45 @@
+/* Core/Inc/rate_limit.h */
+#ifndef INC_RATE_LIMIT_H_
+#define INC_RATE_LIMIT_H_
+
+#include "lwip/arch.h"
+
+/* Source addresses tracked at once; the least recently seen one is recycled */
+#define RATE_LIMIT_CLIENTS      8
+
+/* Connections a client may open back to back */
+#define RATE_LIMIT_BURST        8
+
+/* Sustained connections per second per client */
+#define RATE_LIMIT_PER_SEC      4
+
+/* Longest rendered piece, NUL included: a client entry after the first with
+   255.255.255.255, one-digit tokens (RATE_LIMIT_BURST < 10) and 10-digit counters */
+#define RATE_LIMIT_RENDER_MAX   97
+
+/* What to do with a new connection */
+typedef enum {
+    RATE_PASS = 0,      // Serve normally
+    RATE_THROTTLE,      // Over the limit: answer 429 without doing the work
+    RATE_REJECT         // Over the limit while short on resources: reset right away
+} rate_verdict_t;
+
+/**
+ * @brief  Charges one token to a client's bucket.
+ * @param  ip       : Remote IPv4 address (network byte order)
+ * @param  critical : Non-zero when PCBs or pbufs are nearly exhausted
+ * @retval Verdict for this connection
+ */
+rate_verdict_t rate_limit_check(u32_t ip, uint8_t critical);
+
+/**
+ * @brief  Renders per-client counters as JSON, one piece at a time.
+ * {"clients":[{"ip","tokens","pass","throttled","reset"},..],"throttled":n,"reset":n}
+ * @param  cursor : Render position (start at 0), updated on return
+ * @param  buf    : Output buffer (not NUL-terminated on return)
+ * @param  size   : Size of buf; pieces are cut short below RATE_LIMIT_RENDER_MAX
+ * @retval Number of bytes written to buf, 0 once everything was rendered
+ */
+u16_t rate_limit_render(uint16_t *cursor, char *buf, u16_t size);
+
+#endif /* INC_RATE_LIMIT_H_ */
@@ -0,0 +1,41 @@
+/* Core/Inc/self_bench.h */
+#ifndef INC_SELF_BENCH_H_
+#define INC_SELF_BENCH_H_
+
+#include "lwip/arch.h"
+
+/* Bytes per ENC SRAM transfer (fits the TX buffer) and transfers per timing */
+#define SELF_BENCH_SRAM_LEN     512
+#define SELF_BENCH_RUNS         8
+
+/* Register reads averaged for the latency figure */
+#define SELF_BENCH_REG_RUNS     64
+
+/* Loopback frame, Ethernet header included, and how long to wait for it */
+#define SELF_BENCH_FRAME_LEN    512
+#define SELF_BENCH_FRAME_WAIT_US 5000U
+
+/* Local experimental EtherType (the raw command channel uses 0x88B5) */
+#define SELF_BENCH_TYPE         0x88B6
+
+/* Longest rendered piece, NUL included: "loopback" with 10-digit timings */
+#define SELF_BENCH_RENDER_MAX   94
+
+/**
+ * @brief  Times the building blocks of the frame path in place, one JSON
+ * piece per measurement, so a board revision or a clock / SPI change can be
+ * checked without a logic analyzer:
+ *   {"spi":{"div","hz"},"sram":{"len","wr_kBps","rd_kBps","ok"},
+ *    "reg_ns":n,"chksum":{"len","kBps"},"pbuf_copy":{"len","kBps"},
+ *    "loopback":{"len","tx_us","wire_us","rx_us","ok"}}
+ * kBps is 1000 bytes per second. The loopback frame goes out through
+ * low_level_output() with the PHY looping it back, and comes in through
+ * low_level_input(); other frames received meanwhile are held and passed
+ * to lwIP by the next ethernetif_input().
+ * Blocks up to a few ms per piece; needs the TX buffer free.
+ * Same contract as the HTTP body generators (start with *cursor = 0).
+ * @retval Length of the piece in buf, 0 when done
+ */
+u16_t self_bench_render(uint16_t *cursor, char *buf, u16_t size);
+
+#endif /* INC_SELF_BENCH_H_ */
@@ -0,0 +1,50 @@
+/* Core/Inc/status_cache.h */
+#ifndef INC_STATUS_CACHE_H_
+#define INC_STATUS_CACHE_H_
+
+#include "lwip/arch.h"
+
+/* Room for one complete 200 response (headers + JSON body) */
+#define STATUS_CACHE_SIZE   256
+
+/**
+ * @brief  Marks the cached status as stale. Call whenever a value shown by
+ * GET /api/status changes (GPIO state, telemetry, IP address).
+ */
+void status_cache_bump(void);
+
+/**
+ * @brief  Records the latest telemetry sample and invalidates the cache.
+ * @param  uptime_s : Uptime at the time of the sample, in seconds
+ * @param  count    : Sample counter
+ */
+void status_cache_set_telemetry(uint32_t uptime_s, uint32_t count);
+
+/**
+ * @brief  Records the interface address and invalidates the cache.
+ * @param  ip : IPv4 address (network byte order)
+ */
+void status_cache_set_ip(uint32_t ip);
+
+/**
+ * @brief  Returns the complete HTTP response for GET /api/status.
+ * The body is only re-rendered when the state version moved since the last
+ * call. When the client's If-None-Match is "*" or lists the current ETag
+ * (W/ prefixed or not), a header-only 304 is returned instead.
+ * The buffer is reused by later calls: queue it with TCP_WRITE_FLAG_COPY.
+ * @param  inm     : If-None-Match header value (not NUL-terminated), or NULL
+ * @param  inm_len : Bytes available at inm; the value ends at the first CR or LF
+ * @param  len     : Returns the response length
+ * @retval Response bytes
+ */
+const char *status_cache_get(const char *inm, u16_t inm_len, u16_t *len);
+
+/**
+ * @brief  Returns just the JSON body of the cached status (for non-HTTP transports).
+ * Same buffer and lifetime rules as status_cache_get().
+ * @param  len : Returns the body length
+ * @retval Body bytes (not NUL-terminated)
+ */
+const char *status_cache_body(u16_t *len);
+
+#endif /* INC_STATUS_CACHE_H_ */
@@ -0,0 +1,60 @@
+/* Core/Inc/udp_cmd.h */
+#ifndef INC_UDP_CMD_H_
+#define INC_UDP_CMD_H_
+
+#include "lwip/arch.h"
+
+#define UDP_CMD_PORT        5005
+
+/* Senders remembered for duplicate detection (least recently seen is recycled) */
+#define UDP_CMD_PEERS       4
+
+/* Bytes identifying a sender in that table: the transport's address
+   (IPv4 + port, or MAC) from byte 0, the transport tag in the last byte */
+#define UDP_CMD_KEY_LEN     8
+#define UDP_CMD_KEY_UDP     0x01
+#define UDP_CMD_KEY_ETH     0x02
+
+/*
+ * Frame layout, 8 bytes, multi-byte fields big-endian:
+ *   0  opcode   UDP_CMD_OP_*
+ *   1  flags    UDP_CMD_FLAG_*
+ *   2  seq      Per-sender sequence number; 0 restarts the sequence
+ *   4  mask     Outputs addressed (bit i = cmd output i)
+ *   6  value    New level for each addressed output
+ * The reply has the same size: opcode | 0x80, status, seq, current output
+ * levels, 0.
+ */
+#define UDP_CMD_FRAME_LEN   8
+
+#define UDP_CMD_OP_SET      0x01    // Drive the outputs in mask to the bits in value
+#define UDP_CMD_OP_READ     0x02    // No change, reply with the output levels
+#define UDP_CMD_OP_REPLY    0x80
+
+#define UDP_CMD_FLAG_ACK    0x01    // Sender wants a reply
+
+typedef enum {
+    UDP_CMD_OK = 0,
+    UDP_CMD_BAD_FRAME,      // Wrong length or unknown opcode
+    UDP_CMD_BAD_OUTPUT,     // mask names an output that does not exist
+    UDP_CMD_STALE           // seq older than the last one seen: not applied
+} udp_cmd_status_t;
+
+/**
+ * @brief  Binds the command service to UDP_CMD_PORT.
+ * Commands are applied straight from the receive callback.
+ */
+void udp_cmd_init(void);
+
+/**
+ * @brief  Runs one command frame; shared by every transport carrying the format.
+ * The frame was already checked to be UDP_CMD_FRAME_LEN bytes long.
+ * @param  frame : Command frame
+ * @param  key   : Sender identity for replay detection, UDP_CMD_KEY_LEN bytes
+ *                 ending in the UDP_CMD_KEY_* tag of the transport
+ * @param  reply : Receives the UDP_CMD_FRAME_LEN-byte reply
+ * @retval 1 when the sender asked for a reply (reply is filled), else 0
+ */
+uint8_t udp_cmd_process(const uint8_t *frame, const uint8_t *key, uint8_t *reply);
+
+#endif /* INC_UDP_CMD_H_ */
@@ -20,16 +20,25 @@ const char index_html[] =
 "<body>"
 "<h1>STM32 HTTP Server</h1>"
 "<h3>LED Control</h3>"
+"<p>LED is <b id='led'><!--#led--></b></p>"
 "<button class='btn on' onclick=\"sendCommand('ON')\">TURN ON</button>"
 "<button class='btn off' onclick=\"sendCommand('OFF')\">TURN OFF</button>"
+"<p><small>IP <!--#ip--> &middot; up <!--#uptime-->s &middot; ThingSpeak: <!--#ts--></small></p>"
 "<script>"
+"var ws = new WebSocket('ws://' + location.host + '/ws');"
+"ws.onmessage = function(e) { console.log('Ack:', e.data); };"
 "function sendCommand(cmd) {"
+"  if (ws.readyState === 1) { ws.send(JSON.stringify({cmd: cmd})); return; }"
 "  fetch('/api/cmd', {"
 "    method: 'POST',"
 "    headers: {'Content-Type': 'application/json'},"
 "    body: JSON.stringify({cmd: cmd})"
 "  }).then(r => console.log('Sent:', cmd));"
 "}"
+"var es = new EventSource('/events');"
+"es.addEventListener('led', function(e) {"
+"  document.getElementById('led').textContent = JSON.parse(e.data).led;"
+"});"
 "</script>"
 "</body></html>";
 
@@ -0,0 +1,125 @@
+/* Core/Src/asset_chksum.c
+ *
+ * Precomputed checksums for the constant web assets.
+ *
+ * The static page and the canned replies are queued with tcp_write() without
+ * copying, and with LWIP_CHECKSUM_ON_COPY lwIP sums that data once per
+ * segment through LWIP_HOOK_TCP_NOCOPY_CHKSUM. For a registered asset the
+ * running sum at every ASSET_CHKSUM_CHUNK boundary is known, so the sum of
+ * any slice is the difference of two of them plus the bytes up to the
+ * nearest boundaries: at most two partial chunks are read, however long the
+ * segment is. tcp_output_segment() then only adds the TCP header and the
+ * pseudo-header.
+ *
+ * The sums are built when an asset is registered, with the same routine
+ * lwIP uses, so they always match the bytes actually in flash.
+ */
+
+#include "asset_chksum.h"
+#include "lwip/inet_chksum.h"
+
+struct asset_chksum_asset {
+    const uint8_t *data;
+    u16_t len;
+    uint8_t first;      // Index of its sum at offset 0 in asset_chksum_sums
+};
+
+static struct asset_chksum_asset asset_chksum_assets[ASSET_CHKSUM_ASSETS];
+static uint8_t asset_chksum_count;
+
+/* Running sums: entry first + k covers asset bytes [0, k * ASSET_CHKSUM_CHUNK) */
+static u16_t asset_chksum_sums[ASSET_CHKSUM_SLOTS];
+static uint8_t asset_chksum_used;
+
+/* Plain sum of the bytes, paired from p */
+static u16_t asset_chksum_raw(const uint8_t *p, u16_t len)
+{
+    return (u16_t)~inet_chksum(p, len);
+}
+
+static u16_t asset_chksum_fold(u32_t sum)
+{
+    sum = FOLD_U32T(sum);
+    sum = FOLD_U32T(sum);
+    return (u16_t)sum;
+}
+
+uint8_t asset_chksum_register(const void *data, u16_t len)
+{
+    struct asset_chksum_asset *a;
+    u16_t chunks = len / ASSET_CHKSUM_CHUNK;
+    u16_t k;
+
+    if (asset_chksum_count >= ASSET_CHKSUM_ASSETS ||
+        asset_chksum_used + chunks + 1 > ASSET_CHKSUM_SLOTS)
+    {
+        return 0;
+    }
+
+    a = &asset_chksum_assets[asset_chksum_count++];
+    a->data = (const uint8_t *)data;
+    a->len = len;
+    a->first = asset_chksum_used;
+
+    // Chunks are even-sized, so every sum pairs bytes from the asset start
+    asset_chksum_sums[a->first] = 0;
+    for (k = 0; k < chunks; k++)
+    {
+        asset_chksum_sums[a->first + k + 1] = asset_chksum_fold(
+            (u32_t)asset_chksum_sums[a->first + k] +
+            asset_chksum_raw(a->data + k * ASSET_CHKSUM_CHUNK, ASSET_CHKSUM_CHUNK));
+    }
+    asset_chksum_used += chunks + 1;
+    return 1;
+}
+
+/* Sum of asset bytes [start, end), whole chunks k0..k1 taken from the table */
+static u16_t asset_chksum_slice(const struct asset_chksum_asset *a, u16_t start, u16_t end,
+                                u16_t k0, u16_t k1)
+{
+    u16_t head = (u16_t)(k0 * ASSET_CHKSUM_CHUNK - start);
+    u16_t tail = (u16_t)(k1 * ASSET_CHKSUM_CHUNK);
+    u32_t sum;
+    u16_t h;
+
+    // 1. Bytes before the first boundary, re-paired from the asset start
+    h = asset_chksum_raw(a->data + start, head);
+    if (start & 1) h = (u16_t)SWAP_BYTES_IN_WORD(h);
+
+    // 2. Whole chunks: difference of two running sums (x - y == x + ~y)
+    sum = (u32_t)h + asset_chksum_sums[a->first + k1] +
+          (u16_t)~asset_chksum_sums[a->first + k0];
+
+    // 3. Bytes after the last boundary (even offset: already paired right)
+    sum += asset_chksum_raw(a->data + tail, (u16_t)(end - tail));
+
+    // Caller's pairing starts at start, not at the asset start
+    h = asset_chksum_fold(sum);
+    return (start & 1) ? (u16_t)SWAP_BYTES_IN_WORD(h) : h;
+}
+
+u16_t asset_chksum(const void *p, u16_t len)
+{
+    const uint8_t *b = (const uint8_t *)p;
+    uint8_t i;
+
+    for (i = 0; i < asset_chksum_count; i++)
+    {
+        const struct asset_chksum_asset *a = &asset_chksum_assets[i];
+
+        if (b >= a->data && b + len <= a->data + a->len)
+        {
+            u16_t start = (u16_t)(b - a->data);
+            u16_t end = (u16_t)(start + len);
+            u16_t k0 = (u16_t)((start + ASSET_CHKSUM_CHUNK - 1) / ASSET_CHKSUM_CHUNK);
+            u16_t k1 = (u16_t)(end / ASSET_CHKSUM_CHUNK);
+
+            if (k1 > k0)
+            {
+                return asset_chksum_slice(a, start, end, k0, k1);
+            }
+            break; // Within one or two chunks: the table does not help
+        }
+    }
+    return asset_chksum_raw(b, len);
+}
@@ -0,0 +1,133 @@
+/* Core/Src/chksum_bench.c
+ *
+ * Checksum benchmark: chksum_m0 against lwIP's reference algorithms.
+ * Only built with LWIP_CHKSUM_BENCH (off in production firmware).
+ *
+ * Timed with the 1 us TIM2 counter (metrics_now_us) over the start of flash
+ * (webpage.h defines index_html, so only http_server.c may include it). A
+ * host build only needs CHKSUM_BENCH_NOW defined to its own microsecond
+ * clock, CHKSUM_BENCH_SRC to some buffer and inet_chksum.c built with
+ * LWIP_CHKSUM_BENCH, so the same numbers can be compared with the C
+ * fallback of chksum_m0.
+ */
+
+#include "chksum_bench.h"
+#include "chksum_m0.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/pbuf.h"
+#include <stdio.h>
+#include <string.h>
+
+#if LWIP_CHKSUM_BENCH
+
+#ifndef CHKSUM_BENCH_NOW
+#include "metrics.h"
+#define CHKSUM_BENCH_NOW()  metrics_now_us()
+#endif
+
+#ifndef CHKSUM_BENCH_SRC
+#include "main.h"
+#define CHKSUM_BENCH_SRC    ((const uint8_t *)FLASH_BASE)
+#endif
+
+typedef u16_t (*chksum_bench_fn)(const void *dataptr, int len);
+
+static const struct {
+    const char *name;
+    chksum_bench_fn fn;
+} chksum_bench_algs[] = {
+    { "alg1", lwip_chksum_alg1 },
+    { "alg2", lwip_chksum_alg2 },
+    { "alg3", lwip_chksum_alg3 },
+    { "m0",   chksum_m0 },
+};
+
+#define CHKSUM_BENCH_ALGS   (sizeof(chksum_bench_algs) / sizeof(chksum_bench_algs[0]))
+
+/* Total time of CHKSUM_BENCH_RUNS sums; *sum gets the result */
+static u32_t chksum_bench_time(chksum_bench_fn fn, const uint8_t *data, u16_t *sum)
+{
+    u32_t t0 = CHKSUM_BENCH_NOW();
+    uint8_t i;
+
+    for (i = 0; i < CHKSUM_BENCH_RUNS; i++)
+    {
+        *sum = fn(data, CHKSUM_BENCH_LEN);
+    }
+    return CHKSUM_BENCH_NOW() - t0;
+}
+
+/* memcpy + sum (what LWIP_CHKSUM_COPY did before) vs the fused copy */
+static int chksum_bench_copy(char *buf, u16_t size)
+{
+    struct pbuf *p = pbuf_alloc(PBUF_RAW, TCP_MSS, PBUF_RAM);
+    u32_t t_sep, t_fused;
+    u16_t s_sep = 0, s_fused = 0;
+    uint8_t i;
+    u32_t t0;
+
+    if (p == NULL)
+    {
+        return snprintf(buf, size, "copy: no %u-byte pbuf free", (unsigned)TCP_MSS);
+    }
+
+    t0 = CHKSUM_BENCH_NOW();
+    for (i = 0; i < CHKSUM_BENCH_RUNS; i++)
+    {
+        MEMCPY(p->payload, CHKSUM_BENCH_SRC, TCP_MSS);
+        s_sep = chksum_m0(p->payload, TCP_MSS);
+    }
+    t_sep = CHKSUM_BENCH_NOW() - t0;
+
+    t0 = CHKSUM_BENCH_NOW();
+    for (i = 0; i < CHKSUM_BENCH_RUNS; i++)
+    {
+        s_fused = chksum_m0_copy(p->payload, CHKSUM_BENCH_SRC, TCP_MSS);
+    }
+    t_fused = CHKSUM_BENCH_NOW() - t0;
+    pbuf_free(p);
+
+    return snprintf(buf, size, "copy %u B x %u: memcpy+sum %lu us, fused %lu us%s",
+                    (unsigned)TCP_MSS, (unsigned)CHKSUM_BENCH_RUNS,
+                    (unsigned long)t_sep, (unsigned long)t_fused,
+                    (s_sep == s_fused) ? "" : "  MISMATCH");
+}
+
+u16_t chksum_bench_render(uint16_t *cursor, char *buf, u16_t size)
+{
+    uint16_t pos = (*cursor)++;
+    int n;
+
+    if (pos == 0)
+    {
+        n = snprintf(buf, size, "sum %u B x %u, us: aligned / odd start",
+                     (unsigned)CHKSUM_BENCH_LEN, (unsigned)CHKSUM_BENCH_RUNS);
+    }
+    else if (pos <= CHKSUM_BENCH_ALGS)
+    {
+        // Word-aligned start and one byte in, against algorithm 2's answer
+        const uint8_t *data = (const uint8_t *)(((mem_ptr_t)CHKSUM_BENCH_SRC + 3) & ~(mem_ptr_t)3);
+        chksum_bench_fn fn = chksum_bench_algs[pos - 1].fn;
+        u16_t s_al, s_odd;
+        u32_t t_al = chksum_bench_time(fn, data, &s_al);
+        u32_t t_odd = chksum_bench_time(fn, data + 1, &s_odd);
+        uint8_t ok = (s_al == lwip_chksum_alg2(data, CHKSUM_BENCH_LEN) &&
+                      s_odd == lwip_chksum_alg2(data + 1, CHKSUM_BENCH_LEN));
+
+        n = snprintf(buf, size, "  %-5s %6lu / %6lu%s", chksum_bench_algs[pos - 1].name,
+                     (unsigned long)t_al, (unsigned long)t_odd, ok ? "" : "  MISMATCH");
+    }
+    else if (pos == CHKSUM_BENCH_ALGS + 1)
+    {
+        n = chksum_bench_copy(buf, size);
+    }
+    else
+    {
+        return 0;
+    }
+
+    if (n <= 0) return 0;
+    return (n < size) ? (u16_t)n : (u16_t)(size - 1);
+}
+
+#endif /* LWIP_CHKSUM_BENCH */
@@ -0,0 +1,239 @@
+/* Core/Src/chksum_m0.c
+ *
+ * Internet checksum for the Cortex-M0+ (LWIP_CHKSUM / LWIP_CHKSUM_COPY).
+ *
+ * lwIP's reference versions walk the data a halfword at a time. The M0+ has
+ * no unaligned loads and no DSP adds, but LDM fetches four words for five
+ * cycles and ADCS folds the carries as it goes. So once the pointer is word
+ * aligned the bulk is summed 16 bytes per step (12 bytes when also copying,
+ * the STM needs the registers), and only the edges are done in C.
+ *
+ * The result follows algorithm 2 exactly: sum of host-order halfwords, with
+ * the usual byte swap when the data starts at an odd address.
+ *
+ * Other targets (host builds) get the same structure in plain C.
+ */
+
+#include "chksum_m0.h"
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__ARM_ARCH_6M__)
+#define CHKSUM_M0_ASM   1
+#else
+#define CHKSUM_M0_ASM   0
+#endif
+
+/* 32-bit ones-complement add: the carry goes back into bit 0 */
+static inline uint32_t chksum_m0_add(uint32_t sum, uint32_t w)
+{
+    sum += w;
+    return sum + (sum < w);
+}
+
+/* Sums n blocks of 16 bytes at word-aligned p into sum */
+static uint32_t chksum_m0_blocks(const uint32_t *p, uint32_t n, uint32_t sum)
+{
+#if CHKSUM_M0_ASM
+    // Fixed registers: LDM lists are ascending and r7 may be the frame pointer
+    register const uint32_t *rp __asm("r0") = p;
+    register uint32_t rn __asm("r1") = n;
+    register uint32_t rs __asm("r2") = sum;
+    register uint32_t a __asm("r3");
+    register uint32_t b __asm("r4");
+    register uint32_t c __asm("r5");
+    register uint32_t d __asm("r6");
+
+    // MOVS #imm leaves C alone; two ADCS with 0 fold the carry exactly
+    // (the first can only carry out by wrapping sum to 0)
+    __asm volatile (
+        "1:                         \n"
+        "   ldmia  %[p]!, {r3-r6}   \n"
+        "   adds   %[s], %[s], %[a] \n"
+        "   adcs   %[s], %[b]       \n"
+        "   adcs   %[s], %[c]       \n"
+        "   adcs   %[s], %[d]       \n"
+        "   movs   %[a], #0         \n"
+        "   adcs   %[s], %[a]       \n"
+        "   adcs   %[s], %[a]       \n"
+        "   subs   %[n], #1         \n"
+        "   bne    1b               \n"
+        : [p] "+l" (rp), [n] "+l" (rn), [s] "+l" (rs),
+          [a] "=l" (a), [b] "=l" (b), [c] "=l" (c), [d] "=l" (d)
+        :
+        : "cc", "memory");
+    return rs;
+#else
+    while (n--)
+    {
+        sum = chksum_m0_add(sum, p[0]);
+        sum = chksum_m0_add(sum, p[1]);
+        sum = chksum_m0_add(sum, p[2]);
+        sum = chksum_m0_add(sum, p[3]);
+        p += 4;
+    }
+    return sum;
+#endif
+}
+
+/* Copies n blocks of 12 bytes between word-aligned pointers, summing them */
+static uint32_t chksum_m0_copy_blocks(uint32_t *dst, const uint32_t *src, uint32_t n, uint32_t sum)
+{
+#if CHKSUM_M0_ASM
+    register const uint32_t *rsrc __asm("r0") = src;
+    register uint32_t *rdst __asm("r1") = dst;
+    register uint32_t rn __asm("r2") = n;
+    register uint32_t rs __asm("r3") = sum;
+    register uint32_t a __asm("r4");
+    register uint32_t b __asm("r5");
+    register uint32_t c __asm("r6");
+
+    __asm volatile (
+        "1:                         \n"
+        "   ldmia  %[src]!, {r4-r6} \n"
+        "   stmia  %[dst]!, {r4-r6} \n"
+        "   adds   %[s], %[s], %[a] \n"
+        "   adcs   %[s], %[b]       \n"
+        "   adcs   %[s], %[c]       \n"
+        "   movs   %[a], #0         \n"
+        "   adcs   %[s], %[a]       \n"
+        "   adcs   %[s], %[a]       \n"
+        "   subs   %[n], #1         \n"
+        "   bne    1b               \n"
+        : [src] "+l" (rsrc), [dst] "+l" (rdst), [n] "+l" (rn), [s] "+l" (rs),
+          [a] "=l" (a), [b] "=l" (b), [c] "=l" (c)
+        :
+        : "cc", "memory");
+    return rs;
+#else
+    while (n--)
+    {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        sum = chksum_m0_add(sum, src[0]);
+        sum = chksum_m0_add(sum, src[1]);
+        sum = chksum_m0_add(sum, src[2]);
+        src += 3;
+        dst += 3;
+    }
+    return sum;
+#endif
+}
+
+/* Folds to 16 bits and undoes the pairing shift of an odd start */
+static uint16_t chksum_m0_finish(uint32_t sum, int odd)
+{
+    sum = (sum >> 16) + (sum & 0xFFFFU);
+    sum = (sum >> 16) + (sum & 0xFFFFU);
+    if (odd)
+    {
+        sum = ((sum & 0xFFU) << 8) | ((sum >> 8) & 0xFFU);
+    }
+    return (uint16_t)sum;
+}
+
+/*
+ * Sum of len bytes from pb when pb is at least halfword aligned; t holds a
+ * byte already taken from an odd start.
+ */
+static uint32_t chksum_m0_aligned(const uint8_t *pb, int len, uint16_t t)
+{
+    uint32_t sum = t;
+
+    // 1. Up to the next word boundary
+    if (((uintptr_t)pb & 2) && len > 1)
+    {
+        sum += *(const uint16_t *)(const void *)pb;
+        pb += 2;
+        len -= 2;
+    }
+
+    // 2. Bulk, 16 bytes per step, then the remaining words
+    if (len >= 16)
+    {
+        sum = chksum_m0_blocks((const uint32_t *)(const void *)pb, (uint32_t)len >> 4, sum);
+        pb += len & ~15;
+        len &= 15;
+    }
+    while (len > 3)
+    {
+        sum = chksum_m0_add(sum, *(const uint32_t *)(const void *)pb);
+        pb += 4;
+        len -= 4;
+    }
+
+    // 3. Tail: a halfword and/or a byte (low half of the last halfword)
+    if (len > 1)
+    {
+        sum = chksum_m0_add(sum, *(const uint16_t *)(const void *)pb);
+        pb += 2;
+        len -= 2;
+    }
+    if (len > 0)
+    {
+        sum = chksum_m0_add(sum, *pb);
+    }
+    return sum;
+}
+
+uint16_t chksum_m0(const void *dataptr, int len)
+{
+    const uint8_t *pb = (const uint8_t *)dataptr;
+    int odd = (int)((uintptr_t)pb & 1);
+    uint16_t t = 0;
+
+    // Odd start: first byte becomes the high half of a halfword, swapped back at the end
+    if (odd && len > 0)
+    {
+        ((uint8_t *)&t)[1] = *pb++;
+        len--;
+    }
+    return chksum_m0_finish(chksum_m0_aligned(pb, len, t), odd);
+}
+
+uint16_t chksum_m0_copy(void *dst, const void *src, uint16_t len)
+{
+    const uint8_t *s = (const uint8_t *)src;
+    uint8_t *d = (uint8_t *)dst;
+    int odd = (int)((uintptr_t)s & 1);
+    uint32_t sum = 0;
+    uint16_t t = 0;
+    uint32_t n;
+
+    // Different offsets within a word: no common alignment to reach
+    if ((((uintptr_t)s ^ (uintptr_t)d) & 3) != 0 || len < 32)
+    {
+        memcpy(dst, src, len);
+        return chksum_m0(dst, len);
+    }
+
+    // 1. Head bytes up to the word boundary, summed as chksum_m0() would
+    if (odd)
+    {
+        ((uint8_t *)&t)[1] = *d++ = *s++;
+        len--;
+    }
+    if ((uintptr_t)s & 2)
+    {
+        *(uint16_t *)(void *)d = *(const uint16_t *)(const void *)s;
+        sum += *(const uint16_t *)(const void *)s;
+        s += 2;
+        d += 2;
+        len -= 2;
+    }
+    sum += t;
+
+    // 2. Bulk, copied and summed in the same pass
+    n = len / 12U;
+    if (n > 0)
+    {
+        sum = chksum_m0_copy_blocks((uint32_t *)(void *)d, (const uint32_t *)(const void *)s, n, sum);
+        s += n * 12U;
+        d += n * 12U;
+        len -= (uint16_t)(n * 12U);
+    }
+
+    // 3. The rest (under 12 bytes, word aligned)
+    memcpy(d, s, len);
+    return chksum_m0_finish(chksum_m0_add(sum, chksum_m0_aligned(s, len, 0)), odd);
+}
@@ -0,0 +1,232 @@
+/* Core/Src/cmd_exec.c
+ *
+ * Command layer between the network front-ends and the GPIO outputs.
+ */
+
+#include "cmd_exec.h"
+#include "http_sse.h"
+#include "status_cache.h"
+#include "coap_server.h"
+#include "main.h" // For LED_BLUE_Pin definitions
+#include <string.h>
+
+/* Outputs that commands may address by name */
+struct cmd_output {
+    const char *name;
+    GPIO_TypeDef *port;
+    uint16_t pin;
+};
+
+static const struct cmd_output cmd_outputs[] = {
+    { "led", LED_BLUE_GPIO_Port, LED_BLUE_Pin },
+};
+
+#define CMD_NUM_OUTPUTS (sizeof(cmd_outputs) / sizeof(cmd_outputs[0]))
+
+/* Bounded strstr(): request payloads are not NUL-terminated */
+static const char *cmd_find(const char *buf, u16_t len, const char *needle)
+{
+    u16_t n = (u16_t)strlen(needle);
+    u16_t i;
+
+    for (i = 0; i + n <= len; i++)
+    {
+        if (buf[i] == needle[0] && memcmp(&buf[i], needle, n) == 0)
+        {
+            return &buf[i];
+        }
+    }
+    return NULL;
+}
+
+cmd_action_t cmd_parse(const char *buf, u16_t len)
+{
+    // Simple String Search for JSON (Not robust, but fast for MVP)
+    if (cmd_find(buf, len, "\"cmd\":\"ON\""))
+    {
+        return CMD_ON;
+    }
+    else if (cmd_find(buf, len, "\"cmd\":\"OFF\""))
+    {
+        return CMD_OFF;
+    }
+    return CMD_NONE;
+}
+
+void cmd_execute(cmd_action_t action)
+{
+    cmd_item_t item;
+
+    item.output = 0; // "led"
+    item.action = action;
+    item.hold_ms = 0;
+
+    if (action != CMD_NONE)
+    {
+        cmd_batch_execute(&item, 1);
+    }
+}
+
+/* Resolve "out":"<name>" inside one command object; no "out" means the LED */
+static int cmd_parse_output(const char *obj, u16_t len)
+{
+    const char *p = cmd_find(obj, len, "\"out\":\"");
+    const char *end;
+    uint8_t i;
+
+    if (p == NULL)
+    {
+        return 0;
+    }
+
+    p += 7;
+    end = memchr(p, '"', len - (u16_t)(p - obj));
+    if (end == NULL)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < CMD_NUM_OUTPUTS; i++)
+    {
+        if (strlen(cmd_outputs[i].name) == (size_t)(end - p) &&
+            memcmp(cmd_outputs[i].name, p, end - p) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Optional "ms":<n> inside one command object */
+static uint16_t cmd_parse_hold(const char *obj, u16_t len)
+{
+    const char *p = cmd_find(obj, len, "\"ms\":");
+    const char *end = obj + len;
+    uint32_t ms = 0;
+
+    if (p == NULL)
+    {
+        return 0;
+    }
+
+    for (p += 5; p < end && *p >= '0' && *p <= '9'; p++)
+    {
+        ms = ms * 10 + (uint32_t)(*p - '0');
+        if (ms > CMD_HOLD_MAX_MS) return CMD_HOLD_MAX_MS;
+    }
+    return (uint16_t)ms;
+}
+
+int cmd_batch_parse(const char *buf, u16_t len, cmd_item_t *items)
+{
+    const char *p = cmd_find(buf, len, "\"cmds\":[");
+    const char *end = buf + len;
+    int count = 0;
+
+    if (p == NULL)
+    {
+        return 0;
+    }
+    p += 8;
+
+    // Validate every entry before anything is applied
+    while (p < end && *p != ']')
+    {
+        const char *obj = memchr(p, '{', end - p);
+        const char *obj_end;
+        int out;
+
+        if (obj == NULL) break;
+        obj_end = memchr(obj, '}', end - obj);
+        if (obj_end == NULL || count >= CMD_BATCH_MAX)
+        {
+            return -(count + 1);
+        }
+
+        out = cmd_parse_output(obj, (u16_t)(obj_end - obj));
+        items[count].action = cmd_parse(obj, (u16_t)(obj_end - obj));
+        if (out < 0 || items[count].action == CMD_NONE)
+        {
+            return -(count + 1);
+        }
+        items[count].output = (uint8_t)out;
+        items[count].hold_ms = cmd_parse_hold(obj, (u16_t)(obj_end - obj));
+        count++;
+
+        // Skip to the next entry (or the closing bracket)
+        p = obj_end + 1;
+        while (p < end && (*p == ',' || *p == ' ')) p++;
+    }
+
+    return count;
+}
+
+void cmd_batch_execute(const cmd_item_t *items, uint8_t count)
+{
+    GPIO_TypeDef *ports[CMD_BATCH_MAX];
+    uint32_t bsrr[CMD_BATCH_MAX];
+    uint8_t nports = 0;
+    uint8_t i, j;
+
+    // 1. Fold the commands into one BSRR word per port
+    for (i = 0; i < count; i++)
+    {
+        const struct cmd_output *o = &cmd_outputs[items[i].output];
+
+        for (j = 0; j < nports && ports[j] != o->port; j++);
+        if (j == nports)
+        {
+            ports[nports] = o->port;
+            bsrr[nports] = 0;
+            nports++;
+        }
+
+        // Later commands win: drop any opposite request for the same pin
+        if (items[i].action == CMD_ON)
+        {
+            bsrr[j] = (bsrr[j] & ~((uint32_t)o->pin << 16)) | o->pin;
+        }
+        else
+        {
+            bsrr[j] = (bsrr[j] & ~(uint32_t)o->pin) | ((uint32_t)o->pin << 16);
+        }
+    }
+
+    // 2. Every pin on a port switches in the same write
+    for (j = 0; j < nports; j++)
+    {
+        ports[j]->BSRR = bsrr[j];
+    }
+
+    status_cache_bump();
+    http_sse_publish("led", cmd_led_json());
+    coap_server_notify();
+}
+
+uint8_t cmd_output_count(void)
+{
+    return (uint8_t)CMD_NUM_OUTPUTS;
+}
+
+uint16_t cmd_output_states(void)
+{
+    uint16_t states = 0;
+    uint8_t i;
+
+    for (i = 0; i < CMD_NUM_OUTPUTS; i++)
+    {
+        if (cmd_outputs[i].port->ODR & cmd_outputs[i].pin) states |= (uint16_t)(1U << i);
+    }
+    return states;
+}
+
+const char *cmd_led_state(void)
+{
+    return (HAL_GPIO_ReadPin(LED_BLUE_GPIO_Port, LED_BLUE_Pin) == GPIO_PIN_SET) ? "ON" : "OFF";
+}
+
+const char *cmd_led_json(void)
+{
+    return (HAL_GPIO_ReadPin(LED_BLUE_GPIO_Port, LED_BLUE_Pin) == GPIO_PIN_SET) ?
+           "{\"led\":\"ON\"}" : "{\"led\":\"OFF\"}";
+}
@@ -0,0 +1,190 @@
+/* Core/Src/cmd_queue.c
+ *
+ * Bounded job queue for command sequences (pulses, patterns, ...).
+ *
+ * Submitting only copies the steps into a slot; the HTTP handler replies at
+ * once. Execution is driven by sys_timeout(), i.e. from sys_check_timeouts()
+ * in the main loop, so a long sequence never blocks packet processing.
+ */
+
+#include "cmd_queue.h"
+#include "lwip/timeouts.h"
+#include "lwip/memp.h"
+
+struct cmd_job {
+    uint16_t id;
+    uint8_t state;          // cmd_job_state_t
+    uint8_t step;           // Next step to execute
+    uint8_t count;
+    uint32_t seq;           // Submission order
+    cmd_item_t items[CMD_BATCH_MAX];
+};
+
+static struct cmd_job cmd_jobs[CMD_QUEUE_LEN];
+static uint16_t cmd_next_id = 1;
+static uint32_t cmd_next_seq;
+static struct cmd_job *cmd_running;
+
+/* Forward declarations */
+static void cmd_queue_run(void *arg);
+static struct cmd_job *cmd_queue_next(void);
+static void cmd_queue_start(struct cmd_job *j, u32_t delay_ms);
+
+int cmd_queue_submit(const cmd_item_t *items, uint8_t count)
+{
+    struct cmd_job *slot = NULL;
+    uint8_t i;
+
+    if (count == 0 || count > CMD_BATCH_MAX)
+    {
+        return -1;
+    }
+
+    // Reuse an empty slot, else the oldest finished job
+    for (i = 0; i < CMD_QUEUE_LEN; i++)
+    {
+        struct cmd_job *j = &cmd_jobs[i];
+
+        if (j->state == JOB_UNKNOWN)
+        {
+            slot = j;
+            break;
+        }
+        if ((j->state == JOB_DONE || j->state == JOB_FAILED) && (slot == NULL || j->seq < slot->seq))
+        {
+            slot = j;
+        }
+    }
+    if (slot == NULL)
+    {
+        return -1; // Everything is queued or running
+    }
+
+    slot->id = cmd_next_id;
+    slot->state = JOB_QUEUED;
+    slot->step = 0;
+    slot->count = count;
+    slot->seq = cmd_next_seq++;
+    for (i = 0; i < count; i++)
+    {
+        slot->items[i] = items[i];
+    }
+
+    if (++cmd_next_id == 0) cmd_next_id = 1;
+
+    // Idle runner: start on the next sys_check_timeouts(), not in this callback
+    if (cmd_running == NULL)
+    {
+        cmd_queue_start(slot, 0);
+    }
+
+    return slot->id;
+}
+
+cmd_job_state_t cmd_queue_status(uint16_t id, uint8_t *step, uint8_t *steps)
+{
+    uint8_t i;
+
+    for (i = 0; i < CMD_QUEUE_LEN; i++)
+    {
+        if (cmd_jobs[i].state != JOB_UNKNOWN && cmd_jobs[i].id == id)
+        {
+            if (step != NULL) *step = cmd_jobs[i].step;
+            if (steps != NULL) *steps = cmd_jobs[i].count;
+            return (cmd_job_state_t)cmd_jobs[i].state;
+        }
+    }
+    return JOB_UNKNOWN;
+}
+
+const char *cmd_queue_state_name(cmd_job_state_t state)
+{
+    switch (state)
+    {
+    case JOB_QUEUED:  return "queued";
+    case JOB_RUNNING: return "running";
+    case JOB_DONE:    return "done";
+    case JOB_FAILED:  return "failed";
+    default:          return "unknown";
+    }
+}
+
+/* sys_timeout() returns nothing and only asserts when MEMP_SYS_TIMEOUT is
+   empty, so look at the pool's free list first */
+static int cmd_queue_arm(u32_t delay_ms)
+{
+#if !MEMP_MEM_MALLOC
+    if (*memp_pools[MEMP_SYS_TIMEOUT]->tab == NULL)
+    {
+        return -1;
+    }
+#endif
+    sys_timeout(delay_ms, cmd_queue_run, NULL);
+    return 0;
+}
+
+/* Run j (and, should it fail to start, the queued jobs behind it) */
+static void cmd_queue_start(struct cmd_job *j, u32_t delay_ms)
+{
+    while (j != NULL)
+    {
+        cmd_running = j;
+        j->state = JOB_RUNNING;
+        if (cmd_queue_arm(delay_ms) == 0)
+        {
+            return;
+        }
+        j->state = JOB_FAILED;
+        j = cmd_queue_next();
+    }
+    cmd_running = NULL;
+}
+
+/* Execute one step of the running job and schedule the next one */
+static void cmd_queue_run(void *arg)
+{
+    struct cmd_job *j = cmd_running;
+    const cmd_item_t *it;
+    LWIP_UNUSED_ARG(arg);
+
+    if (j == NULL)
+    {
+        return;
+    }
+
+    it = &j->items[j->step];
+    cmd_batch_execute(it, 1);
+    j->step++;
+
+    if (j->step < j->count)
+    {
+        if (cmd_queue_arm(it->hold_ms) == 0)
+        {
+            return;
+        }
+        // The rest of this job is lost; don't stall the ones behind it
+        j->state = JOB_FAILED;
+        cmd_queue_start(cmd_queue_next(), 0);
+        return;
+    }
+
+    // Job finished: hand over to the oldest queued one
+    j->state = JOB_DONE;
+    cmd_queue_start(cmd_queue_next(), it->hold_ms);
+}
+
+static struct cmd_job *cmd_queue_next(void)
+{
+    struct cmd_job *next = NULL;
+    uint8_t i;
+
+    for (i = 0; i < CMD_QUEUE_LEN; i++)
+    {
+        struct cmd_job *j = &cmd_jobs[i];
+        if (j->state == JOB_QUEUED && (next == NULL || j->seq < next->seq))
+        {
+            next = j;
+        }
+    }
+    return next;
+}
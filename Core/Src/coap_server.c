@@ -0,0 +1,612 @@
+/* Core/Src/coap_server.c
+ *
+ * Minimal CoAP server (RFC 7252) on the raw UDP API, with block-wise
+ * responses (RFC 7959, Block2 only) and Observe (RFC 7641) on /led.
+ *
+ * Every request is answered from the receive callback: a CON request gets a
+ * piggybacked ACK, a NON request a NON response. GET and PUT are both
+ * idempotent here, so a duplicated CON is simply processed again instead of
+ * keeping a response cache (RFC 7252, 4.5).
+ *
+ * Large resources are produced by the same piecewise renderers as the HTTP
+ * endpoints: each block request re-runs the renderer and keeps only the
+ * bytes that fall inside the requested block.
+ *
+ * Notifications are sent NON, except every COAP_CON_EVERY-th one to an
+ * observer and the first after COAP_CON_PERIOD_MS, which are CON (RFC 7641
+ * 4.5). There is no retransmission timer: while a CON is unacknowledged,
+ * later notifications to that observer are CON too, and once
+ * COAP_MAX_RETRANSMIT of them went unanswered for COAP_ACK_TIMEOUT_MS the
+ * observer is considered gone and removed. An observer that no longer wants
+ * notifications answers with RST, which removes it right away.
+ */
+
+#include "coap_server.h"
+#include "cmd_exec.h"
+#include "status_cache.h"
+#include "net_stats.h"
+#include "lwip/udp.h"
+#include "lwip/def.h"
+#include "lwip/sys.h"
+#include <string.h>
+
+/* Message types */
+#define COAP_CON            0
+#define COAP_NON            1
+#define COAP_ACK            2
+#define COAP_RST            3
+
+/* Codes, class.detail packed as (class << 5) | detail */
+#define COAP_CODE(c, d)     (((c) << 5) | (d))
+#define COAP_EMPTY          0
+#define COAP_GET            COAP_CODE(0, 1)
+#define COAP_PUT            COAP_CODE(0, 3)
+#define COAP_CHANGED        COAP_CODE(2, 4)
+#define COAP_CONTENT        COAP_CODE(2, 5)
+#define COAP_BAD_REQUEST    COAP_CODE(4, 0)
+#define COAP_BAD_OPTION     COAP_CODE(4, 2)
+#define COAP_NOT_FOUND      COAP_CODE(4, 4)
+#define COAP_NOT_ALLOWED    COAP_CODE(4, 5)
+
+/* coap_parse() only: no valid token, so there is nothing to answer with */
+#define COAP_FORMAT_ERROR   0xFF
+
+/* Option numbers */
+#define COAP_OPT_URI_HOST   3
+#define COAP_OPT_OBSERVE    6
+#define COAP_OPT_URI_PORT   7
+#define COAP_OPT_URI_PATH   11
+#define COAP_OPT_FORMAT     12
+#define COAP_OPT_URI_QUERY  15
+#define COAP_OPT_ACCEPT     17
+#define COAP_OPT_BLOCK2     23
+
+/* Content formats */
+#define COAP_FMT_TEXT       0
+#define COAP_FMT_LINK       40
+#define COAP_FMT_JSON       50
+
+/* Response size before trimming: header, token, options, one block */
+#define COAP_MAX_OPTIONS    24
+#define COAP_MAX_RESPONSE   (4 + 8 + COAP_MAX_OPTIONS + (16 << COAP_BLOCK_SZX))
+
+#define COAP_NO_OBSERVE     0xFFFFFFFFUL
+
+/* Renders the next piece of a body into buf; 0 when finished (same contract as the HTTP generators) */
+typedef u16_t (*coap_render_fn)(uint16_t *cursor, char *buf, u16_t size);
+
+struct coap_req {
+    uint8_t type;
+    uint8_t code;
+    u16_t mid;
+    uint8_t tkl;
+    uint8_t token[8];
+    char path[24];          // Uri-Path segments joined with '/'
+    u32_t observe;          // COAP_NO_OBSERVE when absent
+    u32_t block_num;        // Block2 requested by the client
+    uint8_t block_szx;
+    const uint8_t *payload;
+    u16_t payload_len;
+};
+
+struct coap_observer {
+    ip_addr_t addr;
+    u16_t port;             // 0 = free slot
+    u16_t mid;              // Last notification, to match an ACK or a RST
+    u32_t con_at;           // sys_now() of the last CON notification
+    uint8_t nons;           // NON notifications since the last CON
+    uint8_t con_tries;      // Unacknowledged CONs in a row, 0 = none pending
+    uint8_t tkl;
+    uint8_t token[8];
+};
+
+static struct udp_pcb *coap_pcb;
+static struct coap_observer coap_observers[COAP_OBSERVERS];
+static uint8_t coap_observer_next;  // Slot replaced when the table is full (round-robin)
+static u32_t coap_observe_seq;      // 24-bit Observe sequence for notifications
+static u16_t coap_mid;
+
+static const char coap_link_format[] =
+    "</led>;obs;ct=0;rt=\"led\",</status>;ct=50,</stats>;ct=50";
+
+/* Appends one option (delta/length nibbles with 13/14 extensions) */
+static uint8_t *coap_opt(uint8_t *w, u16_t *last, u16_t num, const uint8_t *val, u16_t len)
+{
+    u16_t delta = (u16_t)(num - *last);
+    uint8_t *hdr = w++;
+
+    *hdr = 0;
+    if (delta < 13)       { *hdr = (uint8_t)(delta << 4); }
+    else if (delta < 269) { *hdr = 13 << 4; *w++ = (uint8_t)(delta - 13); }
+    else                  { *hdr = 14 << 4; *w++ = (uint8_t)((delta - 269) >> 8); *w++ = (uint8_t)(delta - 269); }
+
+    if (len < 13)         { *hdr |= (uint8_t)len; }
+    else if (len < 269)   { *hdr |= 13; *w++ = (uint8_t)(len - 13); }
+    else                  { *hdr |= 14; *w++ = (uint8_t)((len - 269) >> 8); *w++ = (uint8_t)(len - 269); }
+
+    memcpy(w, val, len);
+    *last = num;
+    return w + len;
+}
+
+/* Unsigned integer option in the fewest bytes (0 is the empty value) */
+static uint8_t *coap_opt_uint(uint8_t *w, u16_t *last, u16_t num, u32_t v)
+{
+    uint8_t b[4];
+    u16_t n = 0;
+    u16_t i;
+
+    while (n < 4 && (v >> (8 * n)) != 0) n++;
+    for (i = 0; i < n; i++)
+    {
+        b[i] = (uint8_t)(v >> (8 * (n - 1 - i)));
+    }
+    return coap_opt(w, last, num, b, n);
+}
+
+static u32_t coap_uint(const uint8_t *v, u16_t len)
+{
+    u32_t x = 0;
+
+    while (len--) x = (x << 8) | *v++;
+    return x;
+}
+
+/* Fixed header and token */
+static uint8_t *coap_header(uint8_t *w, uint8_t type, uint8_t code, u16_t mid,
+                            const uint8_t *token, uint8_t tkl)
+{
+    *w++ = (uint8_t)(0x40 | (type << 4) | tkl); // Version 1
+    *w++ = code;
+    *w++ = (uint8_t)(mid >> 8);
+    *w++ = (uint8_t)mid;
+    memcpy(w, token, tkl);
+    return w + tkl;
+}
+
+/* Messages are built in place in a worst-case sized pbuf, trimmed before sending */
+static void coap_send(struct pbuf *q, const uint8_t *end, const ip_addr_t *addr, u16_t port)
+{
+    pbuf_realloc(q, (u16_t)(end - (const uint8_t *)q->payload));
+    udp_sendto(coap_pcb, q, addr, port);
+    pbuf_free(q);
+}
+
+/* Parses a request; returns 0, the error code to answer with, or COAP_FORMAT_ERROR */
+static uint8_t coap_parse(const uint8_t *msg, u16_t len, struct coap_req *req)
+{
+    const uint8_t *r = msg + 4;
+    const uint8_t *end = msg + len;
+    u16_t num = 0;
+    u16_t plen = 0;
+
+    req->tkl = msg[0] & 0x0F;
+    req->type = (msg[0] >> 4) & 0x03;
+    req->code = msg[1];
+    req->mid = (u16_t)((msg[2] << 8) | msg[3]);
+    req->observe = COAP_NO_OBSERVE;
+    req->block_num = 0;
+    req->block_szx = COAP_BLOCK_SZX;
+    req->payload = NULL;
+    req->payload_len = 0;
+    req->path[0] = '\0';
+
+    if (req->tkl > 8 || r + req->tkl > end)
+    {
+        req->tkl = 0;
+        return COAP_FORMAT_ERROR;
+    }
+    memcpy(req->token, r, req->tkl);
+    r += req->tkl;
+
+    while (r < end && *r != 0xFF)
+    {
+        u16_t delta = *r >> 4;
+        u16_t olen = *r & 0x0F;
+
+        r++;
+        if (delta == 13)      { if (r >= end) return COAP_BAD_REQUEST; delta = (u16_t)(13 + *r++); }
+        else if (delta == 14) { if (r + 1 >= end) return COAP_BAD_REQUEST; delta = (u16_t)(269 + ((r[0] << 8) | r[1])); r += 2; }
+        else if (delta == 15) return COAP_BAD_REQUEST;
+        if (olen == 13)       { if (r >= end) return COAP_BAD_REQUEST; olen = (u16_t)(13 + *r++); }
+        else if (olen == 14)  { if (r + 1 >= end) return COAP_BAD_REQUEST; olen = (u16_t)(269 + ((r[0] << 8) | r[1])); r += 2; }
+        else if (olen == 15)  return COAP_BAD_REQUEST;
+        if (r + olen > end) return COAP_BAD_REQUEST;
+
+        num = (u16_t)(num + delta);
+        switch (num)
+        {
+        case COAP_OPT_URI_PATH:
+            if ((size_t)plen + olen + 2 > sizeof(req->path)) return COAP_NOT_FOUND;
+            if (plen > 0) req->path[plen++] = '/';
+            memcpy(req->path + plen, r, olen);
+            plen = (u16_t)(plen + olen);
+            req->path[plen] = '\0';
+            break;
+        case COAP_OPT_OBSERVE:
+            req->observe = coap_uint(r, olen);
+            break;
+        case COAP_OPT_BLOCK2:
+        {
+            u32_t b = coap_uint(r, olen);
+            req->block_num = b >> 4;
+            req->block_szx = (uint8_t)LWIP_MIN(b & 0x07, COAP_BLOCK_SZX);
+            break;
+        }
+        case COAP_OPT_URI_HOST:
+        case COAP_OPT_URI_PORT:
+        case COAP_OPT_URI_QUERY:
+        case COAP_OPT_ACCEPT:
+            break; // Single host, no queries, one representation per resource
+        default:
+            // Unknown critical (odd) options must be refused, elective ones ignored
+            if (num & 1) return COAP_BAD_OPTION;
+            break;
+        }
+        r += olen;
+    }
+
+    if (r < end)
+    {
+        r++; // Payload marker
+        req->payload = r;
+        req->payload_len = (u16_t)(end - r);
+    }
+    return 0;
+}
+
+/* Largest piece coap_render_block() takes from a renderer */
+#define COAP_RENDER_PIECE   96
+
+#if COAP_RENDER_PIECE < NET_STATS_RENDER_MAX
+#error "COAP_RENDER_PIECE must hold the longest net_stats_render() piece"
+#endif
+
+/* Bytes of a rendered body that fall inside [offset, offset + size) */
+static u16_t coap_render_block(coap_render_fn render, u32_t offset, uint8_t *out, u16_t size, uint8_t *more)
+{
+    char piece[COAP_RENDER_PIECE];
+    uint16_t cursor = 0;
+    u32_t pos = 0;
+    u16_t n, w = 0;
+
+    *more = 0;
+    while ((n = render(&cursor, piece, sizeof(piece))) > 0)
+    {
+        if (pos + n > offset && pos < offset + size)
+        {
+            u32_t from = (offset > pos) ? offset - pos : 0;
+            u32_t to = LWIP_MIN((u32_t)n, offset + size - pos);
+
+            memcpy(out + w, piece + from, to - from);
+            w = (u16_t)(w + (to - from));
+        }
+        pos += n;
+        if (pos > offset + size)
+        {
+            *more = 1;
+            break;
+        }
+    }
+    return w;
+}
+
+/* Same for a body already in memory */
+static u16_t coap_data_block(const char *data, u16_t len, u32_t offset, uint8_t *out, u16_t size, uint8_t *more)
+{
+    u16_t n;
+
+    if (offset >= len)
+    {
+        *more = 0;
+        return 0;
+    }
+    n = (u16_t)LWIP_MIN((u32_t)size, len - offset);
+    memcpy(out, data + offset, n);
+    *more = (offset + n < len);
+    return n;
+}
+
+static void coap_observer_remove(const ip_addr_t *addr, u16_t port, const struct coap_req *req)
+{
+    uint8_t i;
+
+    for (i = 0; i < COAP_OBSERVERS; i++)
+    {
+        struct coap_observer *o = &coap_observers[i];
+
+        if (o->port == port && ip_addr_cmp(&o->addr, addr) &&
+            o->tkl == req->tkl && memcmp(o->token, req->token, req->tkl) == 0)
+        {
+            o->port = 0;
+        }
+    }
+}
+
+static void coap_observer_add(const ip_addr_t *addr, u16_t port, const struct coap_req *req)
+{
+    struct coap_observer *o = NULL;
+    uint8_t i;
+
+    coap_observer_remove(addr, port, req); // Re-registration replaces the old entry
+
+    // A free slot first; a live observer is only replaced when the table is full
+    for (i = 0; i < COAP_OBSERVERS && o == NULL; i++)
+    {
+        if (coap_observers[i].port == 0) o = &coap_observers[i];
+    }
+    if (o == NULL)
+    {
+        o = &coap_observers[coap_observer_next];
+        coap_observer_next = (uint8_t)((coap_observer_next + 1) % COAP_OBSERVERS);
+    }
+
+    ip_addr_copy(o->addr, *addr);
+    o->port = port;
+    o->mid = 0;
+    o->con_at = sys_now();
+    o->nons = 0;
+    o->con_tries = 0;
+    o->tkl = req->tkl;
+    memcpy(o->token, req->token, req->tkl);
+}
+
+/* Handles one request; writes the response options + payload at w.
+ * The payload is rendered into the last block-sized part of the buffer
+ * first (the Block2 option depends on it), then moved behind the options. */
+static uint8_t *coap_handle(struct coap_req *req, const ip_addr_t *addr, u16_t port,
+                            uint8_t *w, uint8_t *body, uint8_t *code)
+{
+    u16_t block = (u16_t)(16U << req->block_szx);
+    u32_t offset = req->block_num * block;
+    u16_t last = 0;
+    u16_t n = 0;
+    uint8_t more = 0;
+    uint8_t format;
+
+    if (strcmp(req->path, "led") == 0)
+    {
+        format = COAP_FMT_TEXT;
+        if (req->code == COAP_PUT)
+        {
+            cmd_action_t action = CMD_NONE;
+
+            if (req->payload_len == 2 && memcmp(req->payload, "ON", 2) == 0) action = CMD_ON;
+            else if (req->payload_len == 3 && memcmp(req->payload, "OFF", 3) == 0) action = CMD_OFF;
+            else if (req->payload != NULL) action = cmd_parse((const char *)req->payload, req->payload_len);
+
+            if (action == CMD_NONE)
+            {
+                *code = COAP_BAD_REQUEST;
+                return w;
+            }
+            cmd_execute(action); // Observers are notified from the command layer
+            *code = COAP_CHANGED;
+        }
+        else if (req->code == COAP_GET)
+        {
+            if (req->observe == 0)
+            {
+                coap_observer_add(addr, port, req);
+                w = coap_opt_uint(w, &last, COAP_OPT_OBSERVE, coap_observe_seq);
+            }
+            else
+            {
+                // GET without Observe (or Observe=1) ends a registration
+                coap_observer_remove(addr, port, req);
+            }
+            *code = COAP_CONTENT;
+        }
+        else
+        {
+            *code = COAP_NOT_ALLOWED;
+            return w;
+        }
+
+        n = (u16_t)strlen(cmd_led_state());
+        memcpy(body, cmd_led_state(), n);
+    }
+    else if (req->code != COAP_GET)
+    {
+        *code = (strcmp(req->path, ".well-known/core") == 0 || strcmp(req->path, "status") == 0 ||
+                 strcmp(req->path, "stats") == 0) ? COAP_NOT_ALLOWED : COAP_NOT_FOUND;
+        return w;
+    }
+    else if (strcmp(req->path, ".well-known/core") == 0)
+    {
+        format = COAP_FMT_LINK;
+        n = coap_data_block(coap_link_format, sizeof(coap_link_format) - 1, offset, body, block, &more);
+    }
+    else if (strcmp(req->path, "status") == 0)
+    {
+        u16_t len;
+        const char *json = status_cache_body(&len);
+
+        format = COAP_FMT_JSON;
+        n = coap_data_block(json, len, offset, body, block, &more);
+    }
+    else if (strcmp(req->path, "stats") == 0)
+    {
+        format = COAP_FMT_JSON;
+        n = coap_render_block(net_stats_render, offset, body, block, &more);
+    }
+    else
+    {
+        *code = COAP_NOT_FOUND;
+        return w;
+    }
+
+    if (n == 0 && offset > 0)
+    {
+        *code = COAP_BAD_OPTION; // Block beyond the end of the resource
+        return w;
+    }
+
+    if (*code != COAP_CHANGED) *code = COAP_CONTENT;
+    w = coap_opt_uint(w, &last, COAP_OPT_FORMAT, format);
+    if (more || req->block_num > 0)
+    {
+        w = coap_opt_uint(w, &last, COAP_OPT_BLOCK2,
+                          (req->block_num << 4) | ((u32_t)more << 3) | req->block_szx);
+    }
+    if (n > 0)
+    {
+        *w++ = 0xFF;
+        memmove(w, body, n);
+        w += n;
+    }
+    return w;
+}
+
+static void coap_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+                      const ip_addr_t *addr, u16_t port)
+{
+    uint8_t msg[COAP_MAX_REQUEST];
+    struct coap_req req;
+    struct pbuf *q;
+    uint8_t *resp;
+    u16_t len = p->tot_len;
+    uint8_t code;
+    uint8_t *w;
+    uint8_t i;
+
+    LWIP_UNUSED_ARG(arg);
+    LWIP_UNUSED_ARG(pcb);
+
+    if (len < 4 || len > sizeof(msg) || pbuf_copy_partial(p, msg, len, 0) != len)
+    {
+        pbuf_free(p);
+        return; // Too short to answer, or too big for a device this small
+    }
+    pbuf_free(p);
+
+    if ((msg[0] >> 6) != 1) return; // Unknown version: silently ignored
+
+    code = coap_parse(msg, len, &req);
+
+    // Format error before a usable token: reject a CON with an empty RST,
+    // silently ignore anything else (RFC 7252 4.2, 4.3)
+    if (code == COAP_FORMAT_ERROR)
+    {
+        q = (req.type == COAP_CON) ? pbuf_alloc(PBUF_TRANSPORT, 4, PBUF_RAM) : NULL;
+        if (q != NULL)
+        {
+            coap_send(q, coap_header((uint8_t *)q->payload, COAP_RST, COAP_EMPTY, req.mid, req.token, 0), addr, port);
+        }
+        return;
+    }
+
+    // RST: an observer telling us to stop. ACK: a CON notification arrived
+    if (req.type == COAP_RST || req.type == COAP_ACK)
+    {
+        for (i = 0; i < COAP_OBSERVERS; i++)
+        {
+            if (coap_observers[i].port == port && coap_observers[i].mid == req.mid &&
+                ip_addr_cmp(&coap_observers[i].addr, addr))
+            {
+                if (req.type == COAP_RST) coap_observers[i].port = 0;
+                else coap_observers[i].con_tries = 0;
+            }
+        }
+        return;
+    }
+
+    // Empty CON is a ping: answer with RST
+    if (req.code == COAP_EMPTY)
+    {
+        q = (req.type == COAP_CON) ? pbuf_alloc(PBUF_TRANSPORT, 4, PBUF_RAM) : NULL;
+        if (q != NULL)
+        {
+            coap_send(q, coap_header((uint8_t *)q->payload, COAP_RST, COAP_EMPTY, req.mid, req.token, 0), addr, port);
+        }
+        return;
+    }
+    if ((req.code >> 5) != 0) return; // Responses are not for us
+
+    q = pbuf_alloc(PBUF_TRANSPORT, COAP_MAX_RESPONSE, PBUF_RAM);
+    if (q == NULL) return; // A CON client retransmits
+    resp = (uint8_t *)q->payload;
+
+    // Piggybacked ACK for CON, fresh NON for NON
+    w = coap_header(resp, (req.type == COAP_CON) ? COAP_ACK : COAP_NON, 0,
+                    (req.type == COAP_CON) ? req.mid : coap_mid++, req.token, req.tkl);
+    if (code == 0)
+    {
+        w = coap_handle(&req, addr, port, w, resp + COAP_MAX_RESPONSE - (16 << COAP_BLOCK_SZX), &code);
+    }
+    resp[1] = code;
+
+    coap_send(q, w, addr, port);
+}
+
+void coap_server_notify(void)
+{
+    const char *state = cmd_led_state();
+    u16_t n = (u16_t)strlen(state);
+    u32_t now = sys_now();
+    uint8_t i;
+
+    if (coap_pcb == NULL) return;
+
+    coap_observe_seq = (coap_observe_seq + 1) & 0xFFFFFFUL;
+
+    for (i = 0; i < COAP_OBSERVERS; i++)
+    {
+        struct coap_observer *o = &coap_observers[i];
+        u16_t last = 0;
+        uint8_t type = COAP_NON;
+        struct pbuf *q;
+        uint8_t *w;
+
+        if (o->port == 0) continue;
+
+        // The first CON and COAP_MAX_RETRANSMIT more all timed out: gone without a RST
+        if (o->con_tries > COAP_MAX_RETRANSMIT && (u32_t)(now - o->con_at) >= COAP_ACK_TIMEOUT_MS)
+        {
+            o->port = 0;
+            continue;
+        }
+
+        q = pbuf_alloc(PBUF_TRANSPORT, 4 + 8 + 12 + n, PBUF_RAM);
+        if (q == NULL) break; // Observers catch up with the next change
+
+        // Every Nth notification, one per period, and all while a CON is pending
+        if (o->con_tries > 0 || ++o->nons >= COAP_CON_EVERY ||
+            (u32_t)(now - o->con_at) >= COAP_CON_PERIOD_MS)
+        {
+            type = COAP_CON;
+            // A CON sent before the last one timed out is not another try
+            if (o->con_tries == 0 || (u32_t)(now - o->con_at) >= COAP_ACK_TIMEOUT_MS)
+            {
+                o->con_at = now;
+                o->con_tries++;
+            }
+            o->nons = 0;
+        }
+
+        o->mid = coap_mid++;
+        w = coap_header((uint8_t *)q->payload, type, COAP_CONTENT, o->mid, o->token, o->tkl);
+        w = coap_opt_uint(w, &last, COAP_OPT_OBSERVE, coap_observe_seq);
+        w = coap_opt_uint(w, &last, COAP_OPT_FORMAT, COAP_FMT_TEXT);
+        *w++ = 0xFF;
+        memcpy(w, state, n);
+        w += n;
+
+        coap_send(q, w, &o->addr, o->port);
+    }
+}
+
+void coap_server_init(void)
+{
+    coap_pcb = udp_new();
+    if (coap_pcb == NULL) return;
+
+    if (udp_bind(coap_pcb, IP_ADDR_ANY, COAP_PORT) != ERR_OK)
+    {
+        udp_remove(coap_pcb);
+        coap_pcb = NULL;
+        return;
+    }
+    coap_mid = (u16_t)sys_now(); // Avoid reusing MIDs from before a reboot
+    udp_recv(coap_pcb, coap_recv, NULL);
+}
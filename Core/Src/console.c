@@ -0,0 +1,150 @@
+/* Core/Src/console.c
+ *
+ * Tiny debug console on USART2. One key = one command; the UART is polled
+ * from the main loop (no interrupt, no RX buffer), which is plenty for a
+ * human typing into a terminal.
+ */
+
+#include "console.h"
+#include "main.h"
+#include "net_stats.h"
+#include "rate_limit.h"
+#include "chksum_bench.h"
+#include "mem_budget.h"
+#include "mem_watch.h"
+#include "iperf_server.h"
+#include "self_bench.h"
+#include <stdio.h>
+
+extern UART_HandleTypeDef huart2;
+
+#if CONSOLE_DUMP_CHUNK < NET_STATS_RENDER_MAX || CONSOLE_DUMP_CHUNK < RATE_LIMIT_RENDER_MAX || \
+    CONSOLE_DUMP_CHUNK < MEM_WATCH_RENDER_MAX || CONSOLE_DUMP_CHUNK < IPERF_SERVER_RENDER_MAX || \
+    CONSOLE_DUMP_CHUNK < SELF_BENCH_RENDER_MAX
+#error "CONSOLE_DUMP_CHUNK must hold the longest piece of every renderer it dumps"
+#endif
+
+struct console_cmd {
+    char key;
+    const char *help;
+    void (*fn)(void);
+};
+
+static void console_help(void);
+static void console_stats(void);
+static void console_clients(void);
+#if LWIP_CHKSUM_BENCH
+static void console_chksum(void);
+#endif
+static void console_profile(void);
+static void console_mem(void);
+static void console_iperf(void);
+static void console_bench(void);
+
+static const struct console_cmd console_cmds[] = {
+    { 's', "lwIP statistics (pools, heap, link, TCP)", console_stats },
+    { 'r', "Rate limiter: per-client counters",        console_clients },
+#if LWIP_CHKSUM_BENCH
+    { 'k', "Checksum benchmark (blocks ~100 ms)",      console_chksum },
+#endif
+    { 'p', "lwIP memory profile: RAM per pool",        console_profile },
+    { 'm', "RAM high-water: stack, sbrk, lwIP pools",  console_mem },
+    { 'i', "Last iperf result (TCP 5001)",             console_iperf },
+    { 'b', "Self-benchmark: SPI, ENC, frame path",     console_bench },
+    { 'h', "This help",                                console_help },
+};
+
+#define CONSOLE_NUM_CMDS (sizeof(console_cmds) / sizeof(console_cmds[0]))
+
+static void console_write(const char *s, u16_t len)
+{
+    HAL_UART_Transmit(&huart2, (uint8_t *)s, len, 100);
+}
+
+void console_poll(void)
+{
+    char c;
+    uint8_t i;
+
+    // An overrun stops reception until it is cleared; we only lose keystrokes
+    if (__HAL_UART_GET_FLAG(&huart2, UART_FLAG_ORE))
+    {
+        __HAL_UART_CLEAR_OREFLAG(&huart2);
+    }
+    if (!__HAL_UART_GET_FLAG(&huart2, UART_FLAG_RXNE))
+    {
+        return;
+    }
+    c = (char)(huart2.Instance->RDR & 0xFF);
+
+    for (i = 0; i < CONSOLE_NUM_CMDS; i++)
+    {
+        if (console_cmds[i].key == c)
+        {
+            console_cmds[i].fn();
+            return;
+        }
+    }
+}
+
+void console_dump(console_render_fn render)
+{
+    char buf[CONSOLE_DUMP_CHUNK];
+    uint16_t cursor = 0;
+    u16_t len;
+
+    while ((len = render(&cursor, buf, sizeof(buf))) > 0)
+    {
+        console_write(buf, len);
+        console_write("\r\n", 2);
+    }
+}
+
+static void console_help(void)
+{
+    char line[64];
+    uint8_t i;
+
+    for (i = 0; i < CONSOLE_NUM_CMDS; i++)
+    {
+        int n = snprintf(line, sizeof(line), "  %c  %s\r\n", console_cmds[i].key, console_cmds[i].help);
+        console_write(line, (u16_t)n);
+    }
+}
+
+static void console_stats(void)
+{
+    console_dump(net_stats_render);
+}
+
+static void console_clients(void)
+{
+    console_dump(rate_limit_render);
+}
+
+#if LWIP_CHKSUM_BENCH
+static void console_chksum(void)
+{
+    console_dump(chksum_bench_render);
+}
+#endif
+
+static void console_profile(void)
+{
+    console_dump(mem_budget_render);
+}
+
+static void console_mem(void)
+{
+    console_dump(mem_watch_render);
+}
+
+static void console_iperf(void)
+{
+    console_dump(iperf_server_render);
+}
+
+static void console_bench(void)
+{
+    console_dump(self_bench_render);
+}
@@ -58,9 +58,10 @@ extern UART_HandleTypeDef huart2; // Tell this file about the UART
 
 /* Work around Errata #5 (spurious reset of ERXWRPT to 0) by placing the RX */
 #define PKTMEM_RX_START 0x0000                            /* RX buffer must be at addr 0 for errata 5 */
-#define PKTMEM_RX_END   (PKTMEM_END-ALIGNED_BUFSIZE)      /* RX buffer length is total SRAM minus TX buffer */
-#define PKTMEM_TX_START (PKTMEM_RX_END+1)                 /* Start TX buffer after */
+#define PKTMEM_TX_START (PKTMEM_END+1-ALIGNED_BUFSIZE)    /* TX buffer at the top of SRAM */
 #define PKTMEM_TX_ENDP1 (PKTMEM_TX_START+ALIGNED_BUFSIZE) /* Allow TX buffer for two frames */
+#define PKTMEM_CACHE_START (PKTMEM_TX_START-ENC_CACHE_SIZE) /* Frame cache below the TX buffer */
+#define PKTMEM_RX_END   (PKTMEM_CACHE_START-1)            /* RX buffer gets the rest */
 
 /* Misc. Helper Macros ******************************************************/
 #define enc_rdgreg(ctrlreg) enc_rdgreg2(ENC_RCR | GETADDR(ctrlreg))
@@ -679,6 +680,10 @@ uint16_t enc_get_packet_length(ENC_HandleTypeDef *handle)
     // Read Next Ptr (2 bytes) + Status (4 bytes)
     enc_rdbuffer(header, 6);
 
+    // The frame itself follows the 6 header bytes (the RX buffer wraps)
+    handle->RxFramePtr = handle->NextPacketPtr + 6;
+    if (handle->RxFramePtr > PKTMEM_RX_END) handle->RxFramePtr -= PKTMEM_RX_END + 1;
+
     // Save the pointer to the NEXT packet for later
     handle->NextPacketPtr = header[0] | (header[1] << 8);
 
@@ -700,8 +705,8 @@ void enc_read_packet_end(ENC_HandleTypeDef *handle)
 	// Move the Hardware Read Pointer to the start of the NEXT packet
 	    uint16_t next_ptr = handle->NextPacketPtr - 1;
 
-	    // Wrap protection (RX Buffer End is usually 0x1FFF)
-	    if (next_ptr > 0x1FFF) next_ptr = 0x1FFF;
+	    // Wrap protection: NextPacketPtr == RX start means "end of the ring"
+	    if (next_ptr > PKTMEM_RX_END) next_ptr = PKTMEM_RX_END;
 
 	    enc_wrbreg(handle, ENC_ERXRDPTL, (next_ptr & 0xFF));
 	    enc_wrbreg(handle, ENC_ERXRDPTH, (next_ptr >> 8));
@@ -712,6 +717,134 @@ void enc_read_packet_end(ENC_HandleTypeDef *handle)
 	    enc_wrbreg(handle, ENC_ECON2, val | ECON2_PKTDEC);
 }
 
+// Copy [start, end] to dst inside the packet memory with the ENC's DMA engine
+static int8_t enc_dma_copy(ENC_HandleTypeDef *handle, uint16_t start, uint16_t end, uint16_t dst)
+{
+    enc_wrbreg(handle, ENC_EDMASTL, start & 0xff);
+    enc_wrbreg(handle, ENC_EDMASTH, start >> 8);
+    enc_wrbreg(handle, ENC_EDMANDL, end & 0xff);
+    enc_wrbreg(handle, ENC_EDMANDH, end >> 8);
+    enc_wrbreg(handle, ENC_EDMADSTL, dst & 0xff);
+    enc_wrbreg(handle, ENC_EDMADSTH, dst >> 8);
+    enc_bfcgreg(ENC_ECON1, ECON1_CSUMEN);
+    enc_bfsgreg(ENC_ECON1, ECON1_DMAST);
+    return enc_waitgreg(ENC_ECON1, ECON1_DMAST, 0) ? ERR_OK : ERR_TIMEOUT;
+}
+
+// 4b. Send (a patched copy of) the frame being read, without moving it over SPI.
+// The ENC's DMA copies it from the RX ring into the TX buffer; only the patches
+// are written. Call before enc_read_packet_end(), which gives the RX space back.
+int8_t enc_reply_from_rx(ENC_HandleTypeDef *handle, uint16_t len, const ENC_PatchTypeDef *patch, uint8_t count)
+{
+    uint16_t src_end = handle->RxFramePtr + len - 1;
+    uint16_t dst = PKTMEM_TX_START + 1; // After the per-packet control byte
+    uint8_t control_write[2];
+    uint8_t i;
+
+    if (len == 0 || PKTMEM_TX_START + len + 8 > PKTMEM_TX_ENDP1) return ERR_MEM;
+    if (src_end > PKTMEM_RX_END) src_end -= PKTMEM_RX_END + 1;
+
+    // The TX buffer is about to be overwritten: previous frame must be out
+    if (!enc_waitgreg(ENC_ECON1, ECON1_TXRTS, 0)) return ERR_TIMEOUT;
+
+    // 1. Control byte, same as enc_prepare_txbuffer()
+    enc_wrbreg(handle, ENC_EWRPTL, PKTMEM_TX_START & 0xff);
+    enc_wrbreg(handle, ENC_EWRPTH, PKTMEM_TX_START >> 8);
+    control_write[0] = ENC_WBM;
+    control_write[1] = PKTCTRL_PCRCEN | PKTCTRL_PPADEN;
+    SPIx_TxBuf(control_write, control_write, 2);
+
+    // 2. DMA copy (wraps at the end of the RX ring by itself)
+    if (enc_dma_copy(handle, handle->RxFramePtr, src_end, dst) != ERR_OK) return ERR_TIMEOUT;
+
+    // 3. Patches
+    for (i = 0; i < count; i++)
+    {
+        uint16_t at = dst + patch[i].offset;
+
+        enc_wrbreg(handle, ENC_EWRPTL, at & 0xff);
+        enc_wrbreg(handle, ENC_EWRPTH, at >> 8);
+        enc_wrbuffer((void *)patch[i].data, patch[i].len);
+    }
+
+    // 4. Send (sets ETXST/ETXND from transmitLength)
+    handle->transmitLength = len;
+    enc_transmit(handle);
+    return ERR_OK;
+}
+
+// 4c. Frame cache: load bytes into the cache region (outside RX ring and TX buffer)
+int8_t enc_cache_write(ENC_HandleTypeDef *handle, uint16_t offset, const void *data, uint16_t len)
+{
+    uint16_t at = PKTMEM_CACHE_START + offset;
+
+    if (len == 0 || offset + len > ENC_CACHE_SIZE) return ERR_MEM;
+
+    enc_wrbreg(handle, ENC_EWRPTL, at & 0xff);
+    enc_wrbreg(handle, ENC_EWRPTH, at >> 8);
+    enc_wrbuffer((void *)data, len);
+    return ERR_OK;
+}
+
+// 4d. While a frame is being written after enc_prepare_txbuffer(): place len cached
+// bytes at frame_offset by DMA, and leave the write pointer after them
+int8_t enc_tx_from_cache(ENC_HandleTypeDef *handle, uint16_t offset, uint16_t frame_offset, uint16_t len)
+{
+    uint16_t src = PKTMEM_CACHE_START + offset;
+    uint16_t dst = PKTMEM_TX_START + 1 + frame_offset;
+
+    if (len == 0 || offset + len > ENC_CACHE_SIZE) return ERR_MEM;
+    if (enc_dma_copy(handle, src, src + len - 1, dst) != ERR_OK) return ERR_TIMEOUT;
+
+    enc_wrbreg(handle, ENC_EWRPTL, (dst + len) & 0xff);
+    enc_wrbreg(handle, ENC_EWRPTH, (dst + len) >> 8);
+    return ERR_OK;
+}
+
+// 4e. Self-test access to the TX buffer, which is free once the last frame is out.
+// Overwrites it: use between frames only
+int8_t enc_scratch_write(ENC_HandleTypeDef *handle, const void *data, uint16_t len)
+{
+    if (len == 0 || PKTMEM_TX_START + len > PKTMEM_TX_ENDP1) return ERR_MEM;
+    if (!enc_waitgreg(ENC_ECON1, ECON1_TXRTS, 0)) return ERR_TIMEOUT;
+
+    enc_wrbreg(handle, ENC_EWRPTL, PKTMEM_TX_START & 0xff);
+    enc_wrbreg(handle, ENC_EWRPTH, PKTMEM_TX_START >> 8);
+    enc_wrbuffer((void *)data, len);
+    return ERR_OK;
+}
+
+int8_t enc_scratch_read(ENC_HandleTypeDef *handle, void *data, uint16_t len)
+{
+    if (len == 0 || PKTMEM_TX_START + len > PKTMEM_TX_ENDP1) return ERR_MEM;
+
+    // ERDPT is set again by enc_get_packet_length() before every frame
+    enc_wrbreg(handle, ENC_ERDPTL, PKTMEM_TX_START & 0xff);
+    enc_wrbreg(handle, ENC_ERDPTH, PKTMEM_TX_START >> 8);
+    enc_rdbuffer(data, len);
+    return ERR_OK;
+}
+
+// 4f. Receive our own transmissions (self-test). Half duplex loops them back
+// unless PHCON2.HDLDIS is set, as enc_start() does; full duplex needs PLOOPBK,
+// which also keeps them off the wire. Only that bit changes, the rest of the
+// PHY setup is read back and kept
+void enc_set_loopback(ENC_HandleTypeDef *handle, bool on)
+{
+    uint16_t v;
+
+    if (handle->Init.DuplexMode == ETH_MODE_HALFDUPLEX)
+    {
+        v = enc_rdphy(handle, ENC_PHCON2);
+        enc_wrphy(handle, ENC_PHCON2, on ? (v & ~PHCON2_HDLDIS) : (v | PHCON2_HDLDIS));
+    }
+    else
+    {
+        v = enc_rdphy(handle, ENC_PHCON1);
+        enc_wrphy(handle, ENC_PHCON1, on ? (v | PHCON1_PLOOPBK) : (v & ~PHCON1_PLOOPBK));
+    }
+}
+
 // 5. The "Force MAC" function (Fixes main.c errors)
 void enc_force_mac_hardware(ENC_HandleTypeDef *handle)
 {
@@ -0,0 +1,72 @@
+/* Core/Src/enc_cache.c
+ *
+ * Frame cache in the ENC28J60 packet memory.
+ *
+ * The hot static payloads (the literal parts of index_html, the fixed JSON
+ * replies) are written once into a region of ENC SRAM that neither the RX
+ * ring nor the TX buffer uses. When lwIP later hands the driver a pbuf whose
+ * payload points into one of them, the driver has the ENC's DMA engine copy
+ * those bytes into the TX buffer, so only the headers lwIP built for this
+ * connection (MACs, IP ID, ports, seq/ack, checksums) cross the SPI bus.
+ *
+ * Objects are matched by address, which is why only data that never moves
+ * or changes may be registered.
+ */
+
+#include "enc_cache.h"
+#include "enc28j60.h"
+#include "lwip/def.h"
+
+extern ENC_HandleTypeDef henc;
+
+struct enc_cache_obj {
+    const uint8_t *data;
+    u16_t len;          // Bytes cached (may be less than the object)
+    u16_t offset;       // Where they start in the cache region
+};
+
+static struct enc_cache_obj enc_cache_objs[ENC_CACHE_OBJECTS];
+static uint8_t enc_cache_count;
+static u16_t enc_cache_used;
+
+u16_t enc_cache_add(const void *data, u16_t len)
+{
+    struct enc_cache_obj *o;
+    u16_t n = (u16_t)LWIP_MIN(len, ENC_CACHE_SIZE - enc_cache_used);
+
+    if (enc_cache_count >= ENC_CACHE_OBJECTS || n < ENC_CACHE_MIN_RUN)
+    {
+        return 0;
+    }
+    if (enc_cache_write(&henc, enc_cache_used, data, n) != ERR_OK)
+    {
+        return 0;
+    }
+
+    o = &enc_cache_objs[enc_cache_count++];
+    o->data = (const uint8_t *)data;
+    o->len = n;
+    o->offset = enc_cache_used;
+    enc_cache_used += n;
+    return n;
+}
+
+u16_t enc_cache_lookup(const void *p, u16_t len, u16_t *offset)
+{
+    const uint8_t *b = (const uint8_t *)p;
+    uint8_t i;
+
+    for (i = 0; i < enc_cache_count; i++)
+    {
+        const struct enc_cache_obj *o = &enc_cache_objs[i];
+
+        if (b >= o->data && b < o->data + o->len)
+        {
+            u16_t at = (u16_t)(b - o->data);
+
+            *offset = (u16_t)(o->offset + at);
+            return (u16_t)LWIP_MIN(len, o->len - at);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,37 @@
+/* Core/Src/eth_cmd.c
+ *
+ * GPIO commands straight on Ethernet (EtherType ETH_CMD_TYPE).
+ *
+ * For controllers on the same L2 segment: no ARP, IP or UDP, and no lwIP
+ * memory at all. ethernetif.c recognizes the EtherType from the first 14
+ * bytes it reads out of the ENC28J60, reads the 8-byte command into a local
+ * buffer and hands it here; the reply goes back out through the driver's
+ * own transmit buffer.
+ *
+ * The payload is the UDP command frame (udp_cmd.h), executed by the same
+ * code, with the sender's MAC as its identity for replay detection.
+ */
+
+#include "eth_cmd.h"
+#include "udp_cmd.h"
+#include <string.h>
+
+u16_t eth_cmd_input(const uint8_t *frame, const uint8_t *hwaddr, uint8_t *reply)
+{
+    uint8_t key[UDP_CMD_KEY_LEN];
+
+    memset(key, 0, sizeof(key));
+    memcpy(key, frame + 6, 6); // Source MAC
+    key[UDP_CMD_KEY_LEN - 1] = UDP_CMD_KEY_ETH;
+
+    if (!udp_cmd_process(frame + ETH_CMD_HDR_LEN, key, reply + ETH_CMD_HDR_LEN))
+    {
+        return 0;
+    }
+
+    memcpy(reply, frame + 6, 6);    // Back to the sender
+    memcpy(reply + 6, hwaddr, 6);
+    reply[12] = ETH_CMD_TYPE >> 8;
+    reply[13] = ETH_CMD_TYPE & 0xFF;
+    return ETH_CMD_LEN;
+}
@@ -26,12 +26,18 @@
 #include "lwip/snmp.h"
 #include "lwip/ethip6.h"
 #include "lwip/etharp.h"
+#include "lwip/prot/ip.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/icmp.h"
 #include "netif/ethernet.h"
 #include "ethernetif.h"
 
 /* INCLUDE YOUR DRIVER */
 #include "enc28j60.h"
 #include "main.h"
+#include "metrics.h"
+#include "eth_cmd.h"
+#include "enc_cache.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -47,6 +53,20 @@ extern ENC_HandleTypeDef henc;
 /* Helper buffer to flatten pbufs before sending to ENC */
 static uint8_t eth_tx_buffer[1514];
 
+/* Bytes looked at before deciding who gets a frame: Ethernet + IPv4 (no options) + ICMP type/code/checksum */
+#define ETH_PEEK_LEN    (ETH_CMD_HDR_LEN + IP_HLEN + 4)
+
+/* Frames read while lwIP could not take them (self-test), oldest at eth_held_head */
+#define ETH_HELD_FRAMES 4
+static struct pbuf *eth_held[ETH_HELD_FRAMES];
+static uint8_t eth_held_head;
+static uint8_t eth_held_count;
+
+static uint8_t low_level_cached(struct pbuf *p);
+static err_t low_level_output_cached(struct pbuf *p);
+static err_t low_level_transmit(uint16_t len);
+static uint8_t low_level_icmp_echo(struct netif *netif, const uint8_t *frame, uint16_t len);
+
 /**
  * In this function, the hardware should be initialized.
  * Called from ethernetif_init().
@@ -83,13 +103,95 @@ static void low_level_init(struct netif *netif)
  */
 static err_t low_level_output(struct netif *netif, struct pbuf *p)
 {
-	const uint16_t MIN_FRAME_LEN = 60;
 	  uint16_t len = p->tot_len;
+	  uint32_t t0 = metrics_now_us();
+	  err_t err;
 
-	  /* 1. Flatten pbuf */
-	  if (pbuf_copy_partial(p, eth_tx_buffer, len, 0) != len) {
-	      return ERR_BUF;
+	  /* 1. Static payload already in ENC SRAM: only the headers go over SPI */
+	  if (low_level_cached(p)) {
+	      err = low_level_output_cached(p);
+	  } else {
+	      /* Flatten pbuf */
+	      if (pbuf_copy_partial(p, eth_tx_buffer, len, 0) != len) {
+	          return ERR_BUF;
+	      }
+	      err = low_level_transmit(len);
+	  }
+	  if (err == ERR_OK) {
+	      metrics_observe(METRIC_ETH_TX, metrics_now_us() - t0);
 	  }
+	  return err;
+}
+
+/**
+ * True when some pbuf of the frame starts with a run of the ENC frame cache
+ * long enough to be worth a DMA copy. Short frames take the padded path.
+ */
+static uint8_t low_level_cached(struct pbuf *p)
+{
+	struct pbuf *q;
+	u16_t offset;
+
+	  if (p->tot_len < 60) {
+	      return 0;
+	  }
+	  for (q = p->next; q != NULL; q = q->next) {
+	      if (enc_cache_lookup(q->payload, q->len, &offset) >= ENC_CACHE_MIN_RUN) {
+	          return 1;
+	      }
+	  }
+	  return 0;
+}
+
+/**
+ * Writes the frame straight into the ENC TX buffer: cached runs are copied
+ * inside the chip by DMA, everything else is written over SPI.
+ */
+static err_t low_level_output_cached(struct pbuf *p)
+{
+	struct pbuf *q;
+	uint16_t pos = 0;
+
+	  if (enc_prepare_txbuffer(&henc, p->tot_len) != 0) {
+	      LINK_STATS_INC(link.err);
+	      return ERR_IF;
+	  }
+
+	  for (q = p; q != NULL; q = q->next) {
+	      const uint8_t *src = (const uint8_t *)q->payload;
+	      u16_t left = q->len;
+	      u16_t offset;
+	      u16_t n = enc_cache_lookup(src, left, &offset);
+
+	      if (n >= ENC_CACHE_MIN_RUN) {
+	          if (enc_tx_from_cache(&henc, offset, pos, n) != 0) {
+	              LINK_STATS_INC(link.err);
+	              return ERR_IF;
+	          }
+	          src += n;
+	          left -= n;
+	          pos += n;
+	      }
+	      if (left > 0) {
+	          enc_wrbuffer((void *)src, left);
+	          pos += left;
+	      }
+	  }
+
+	  henc.transmitLength = p->tot_len;
+	  enc_transmit(&henc);
+
+	  LINK_STATS_INC(link.xmit);
+	  return ERR_OK;
+}
+
+/**
+ * Pads and sends the frame held in eth_tx_buffer.
+ * Shared by lwIP's output and the raw command channel.
+ */
+static err_t low_level_transmit(uint16_t len)
+{
+	const uint16_t MIN_FRAME_LEN = 60;
 
 	  /* 2. MANUAL PADDING (Critical for ARP) */
 	  if (len < MIN_FRAME_LEN) {
@@ -99,6 +201,7 @@ static err_t low_level_output(struct netif *netif, struct pbuf *p)
 
 	  /* 3. Prepare & Write */
 	  if (enc_prepare_txbuffer(&henc, len) != 0) {
+	      LINK_STATS_INC(link.err);
 	      return ERR_IF;
 	  }
 	  enc_wrbuffer(eth_tx_buffer, len);
@@ -107,6 +210,7 @@ static err_t low_level_output(struct netif *netif, struct pbuf *p)
 	  /* 4. Trigger Transmission */
 	  enc_transmit(&henc);
 
+	  LINK_STATS_INC(link.xmit);
 	  return ERR_OK;
 }
 
@@ -119,6 +223,8 @@ static struct pbuf * low_level_input(struct netif *netif)
 	struct pbuf *p = NULL;
 	  struct pbuf *q;
 	  uint16_t len;
+	  uint8_t hdr[ETH_PEEK_LEN];
+	  uint16_t peeked = ETH_CMD_HDR_LEN;
 	  char debug_msg[64];
 
 	  /* 1. Check if packet exists */
@@ -135,27 +241,159 @@ static struct pbuf * low_level_input(struct netif *netif)
 	      HAL_UART_Transmit(&huart2, (uint8_t*)debug_msg, strlen(debug_msg), 100);
 	  }
 
-	  /* 3. Allocate Buffer */
+	  /* 3. Raw command channel: classified on the header, handled without lwIP */
+	  if (len < ETH_CMD_HDR_LEN) {
+	      enc_read_packet_end(&henc); // Runt: nothing to deliver
+	      LINK_STATS_INC(link.drop);
+	      return NULL;
+	  }
+	  enc_rd_packet_payload(&henc, hdr, ETH_CMD_HDR_LEN);
+	  if (eth_cmd_match(hdr)) {
+	      uint16_t reply = 0;
+
+	      if (len >= ETH_CMD_LEN) {
+	          enc_rd_packet_payload(&henc, hdr + ETH_CMD_HDR_LEN, ETH_CMD_LEN - ETH_CMD_HDR_LEN);
+	          reply = eth_cmd_input(hdr, netif->hwaddr, eth_tx_buffer);
+	      }
+	      enc_read_packet_end(&henc);
+	      LINK_STATS_INC(link.recv);
+
+	      if (reply > 0) {
+	          low_level_transmit(reply);
+	      }
+	      return NULL;
+	  }
+
+	  /* 4. ICMP echo fast path: answered from ENC SRAM, see low_level_icmp_echo() */
+	  if (hdr[12] == 0x08 && hdr[13] == 0x00 && len >= ETH_PEEK_LEN) {
+	      enc_rd_packet_payload(&henc, hdr + ETH_CMD_HDR_LEN, ETH_PEEK_LEN - ETH_CMD_HDR_LEN);
+	      peeked = ETH_PEEK_LEN;
+
+	      if (low_level_icmp_echo(netif, hdr, len)) {
+	          enc_read_packet_end(&henc);
+	          LINK_STATS_INC(link.recv);
+	          LINK_STATS_INC(link.xmit);
+	          return NULL;
+	      }
+	  }
+
+	  /* 5. Allocate Buffer */
 	  if (len > 0) {
 	      p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
 	  }
 
-	  /* 4. Read Payload into pbuf */
+	  /* 6. Read Payload into pbuf (the first bytes were already read above) */
 	  if (p != NULL) {
+	      uint32_t t0 = metrics_now_us();
+	      uint16_t skip = peeked;
+
 	      for (q = p; q != NULL; q = q->next) {
-	          enc_rd_packet_payload(&henc, (uint8_t *)q->payload, q->len);
+	          uint16_t n = LWIP_MIN(skip, q->len);
+
+	          memcpy(q->payload, hdr + peeked - skip, n);
+	          if (q->len > n) {
+	              enc_rd_packet_payload(&henc, (uint8_t *)q->payload + n, q->len - n);
+	          }
+	          skip -= n;
 	      }
 
 	      // Acknowledge that we finished reading
 	      enc_read_packet_end(&henc);
+	      metrics_observe(METRIC_ETH_RX, metrics_now_us() - t0);
+	      LINK_STATS_INC(link.recv);
 	  } else {
 	      // Allocation failed or length 0, but we must flush the packet from hardware
 	      enc_read_packet_end(&henc);
+	      LINK_STATS_INC(link.memerr);
+	      LINK_STATS_INC(link.drop);
 	  }
 
 	  return p; // Return the pbuf (or NULL) to LwIP
 }
 
+/* One's complement checksum after replacing the 16-bit word 'old' by 'new' (RFC 1624) */
+static uint16_t low_level_csum_adjust(uint16_t sum, uint16_t old, uint16_t new)
+{
+	uint32_t s = (uint16_t)~sum + (uint32_t)(uint16_t)~old + new;
+
+	  s = (s & 0xFFFF) + (s >> 16);
+	  s = (s & 0xFFFF) + (s >> 16);
+	  return (uint16_t)~s;
+}
+
+/**
+ * Answers an ICMP echo request to our address without lwIP: the ENC copies
+ * the request from its RX ring into the TX buffer (DMA) and only the
+ * addresses, TTL, type and the two checksums are rewritten, adjusted
+ * incrementally. A ping costs a few dozen SPI bytes instead of moving the
+ * whole frame in and out, and no pbuf.
+ * The ICMP checksum is not verified (that would need the payload, or the
+ * ENC's DMA checksum, which errata makes unreliable with RX enabled); the
+ * Ethernet CRC already covers it and the reply keeps the sender's error.
+ * Returns 1 when the reply was sent; anything unusual goes to lwIP instead.
+ */
+static uint8_t low_level_icmp_echo(struct netif *netif, const uint8_t *frame, uint16_t len)
+{
+	const uint8_t *ip = frame + ETH_CMD_HDR_LEN;
+	  const uint8_t *icmp = ip + IP_HLEN;
+	  uint8_t patch[ETH_PEEK_LEN];
+	  ENC_PatchTypeDef patches[2];
+	  uint16_t sum, i;
+	  uint32_t acc = 0;
+
+	  // Plain IPv4 (no options, not fragmented), to our unicast MAC and address
+	  if (ip[0] != 0x45 || ip[9] != IP_PROTO_ICMP || (ip[6] & 0x3F) != 0 || ip[7] != 0 ||
+	      icmp[0] != ICMP_ECHO || icmp[1] != 0 ||
+	      memcmp(frame, netif->hwaddr, ETH_HWADDR_LEN) != 0 ||
+	      ip4_addr_isany_val(*netif_ip4_addr(netif)) ||
+	      memcmp(ip + 16, netif_ip4_addr(netif), 4) != 0 ||
+	      ((ip[2] << 8) | ip[3]) + ETH_CMD_HDR_LEN > len) {
+	      return 0;
+	  }
+
+	  // The IP header is all here: check it like ip4_input() would
+	  for (i = 0; i < IP_HLEN; i += 2) {
+	      acc += (uint16_t)((ip[i] << 8) | ip[i + 1]);
+	  }
+	  acc = (acc & 0xFFFF) + (acc >> 16);
+	  acc = (acc & 0xFFFF) + (acc >> 16);
+	  if (acc != 0xFFFF) {
+	      return 0;
+	  }
+
+	  memcpy(patch, frame, sizeof(patch));
+
+	  // Ethernet: back to the sender
+	  memcpy(patch, frame + 6, ETH_HWADDR_LEN);
+	  memcpy(patch + 6, netif->hwaddr, ETH_HWADDR_LEN);
+
+	  // IP: fresh TTL, swapped addresses (the swap leaves the checksum alone)
+	  sum = (uint16_t)((ip[10] << 8) | ip[11]);
+	  sum = low_level_csum_adjust(sum, (uint16_t)((ip[8] << 8) | ip[9]), (uint16_t)((ICMP_TTL << 8) | ip[9]));
+	  patch[ETH_CMD_HDR_LEN + 8] = ICMP_TTL;
+	  patch[ETH_CMD_HDR_LEN + 10] = (uint8_t)(sum >> 8);
+	  patch[ETH_CMD_HDR_LEN + 11] = (uint8_t)sum;
+	  memcpy(patch + ETH_CMD_HDR_LEN + 12, ip + 16, 4);
+	  memcpy(patch + ETH_CMD_HDR_LEN + 16, ip + 12, 4);
+
+	  // ICMP: echo request -> reply
+	  sum = (uint16_t)((icmp[2] << 8) | icmp[3]);
+	  sum = low_level_csum_adjust(sum, ICMP_ECHO << 8, ICMP_ER << 8);
+	  patch[ETH_CMD_HDR_LEN + IP_HLEN] = ICMP_ER;
+	  patch[ETH_CMD_HDR_LEN + IP_HLEN + 2] = (uint8_t)(sum >> 8);
+	  patch[ETH_CMD_HDR_LEN + IP_HLEN + 3] = (uint8_t)sum;
+
+	  // Two writes: MAC addresses, then TTL .. ICMP checksum
+	  patches[0].offset = 0;
+	  patches[0].data = patch;
+	  patches[0].len = 2 * ETH_HWADDR_LEN;
+	  patches[1].offset = ETH_CMD_HDR_LEN + 8;
+	  patches[1].data = patch + ETH_CMD_HDR_LEN + 8;
+	  patches[1].len = ETH_PEEK_LEN - (ETH_CMD_HDR_LEN + 8);
+
+	  return enc_reply_from_rx(&henc, len, patches, 2) == ERR_OK;
+}
+
 /**
  * This function should be called when a packet is ready to be read
  * from the interface. It uses the function low_level_input() that
@@ -167,6 +405,9 @@ void ethernetif_input(struct netif *netif)
 {
   struct pbuf *p;
 
+  // Frames held back while lwIP was busy are older than anything in the ENC
+  ethernetif_release_held(netif);
+
   // Poll the hardware
   p = low_level_input(netif);
 
@@ -178,6 +419,63 @@ void ethernetif_input(struct netif *netif)
       pbuf_free(p);
     }
   }
+
+  // A self-test run from that frame's callbacks may have held some more
+  ethernetif_release_held(netif);
+}
+
+/**
+ * Keeps a frame read outside the main loop (self-test inside a lwIP
+ * callback, where netif->input must not be re-entered) until the next
+ * ethernetif_input(). Frames beyond ETH_HELD_FRAMES are dropped.
+ */
+void ethernetif_hold_frame(struct pbuf *p)
+{
+  if (eth_held_count < ETH_HELD_FRAMES)
+  {
+    eth_held[(eth_held_head + eth_held_count) % ETH_HELD_FRAMES] = p;
+    eth_held_count++;
+  }
+  else
+  {
+    pbuf_free(p);
+    LINK_STATS_INC(link.drop);
+  }
+}
+
+/**
+ * Hands the held frames to lwIP in arrival order. Only call it where
+ * netif->input may run, i.e. from the main loop.
+ */
+void ethernetif_release_held(struct netif *netif)
+{
+  while (eth_held_count > 0)
+  {
+    struct pbuf *p = eth_held[eth_held_head];
+
+    eth_held_head = (eth_held_head + 1) % ETH_HELD_FRAMES;
+    eth_held_count--;
+    if (netif->input(p, netif) != ERR_OK)
+    {
+      pbuf_free(p);
+    }
+  }
+}
+
+/* Non-zero while held frames wait for ethernetif_input() */
+uint8_t ethernetif_held_pending(void)
+{
+  return eth_held_count != 0;
+}
+
+/**
+ * Reads one frame from the interface without handing it to lwIP (self-test).
+ * The raw command channel and ICMP echo fast path still answer their frames
+ * and return NULL, as for ethernetif_input().
+ */
+struct pbuf *ethernetif_read_frame(struct netif *netif)
+{
+  return low_level_input(netif);
 }
 
 /**
@@ -0,0 +1,331 @@
+/* Core/Src/fw_update.c
+ *
+ * Streaming firmware update.
+ *
+ * The image never exists in RAM: every received chunk is programmed into the
+ * staging slot (double-word at a time, erasing each page when data first
+ * reaches it) while a running CRC-32 is kept. When the whole image is in and
+ * the CRC of the *flash contents* matches, a small record in the META page
+ * marks it as pending. On the next boot fw_update_boot_check() copies the
+ * staging slot over the application from a RAM-resident routine and resets.
+ *
+ * Nothing authenticates the upload: the CRC only catches transfer errors.
+ * POST /api/firmware is meant for a lab network; anyone who can reach port 80
+ * can replace the firmware. That is why none of this is built unless
+ * FW_UPDATE_ENABLE is set (main.h).
+ */
+
+#include "fw_update.h"
+#include "main.h"
+#include "lwip/def.h"
+#include "lwip/timeouts.h"
+#include <string.h>
+
+#if FW_UPDATE_ENABLE
+
+#define FW_UPDATE_STR_(x)   #x
+#define FW_UPDATE_STR(x)    FW_UPDATE_STR_(x)
+
+/* Largest application image, checked by the linker script (see mem_budget.c) */
+__asm__(".global fw_app_slot\n\t"
+        ".set fw_app_slot, " FW_UPDATE_STR(FW_SLOT_SIZE));
+
+#define FW_META_MAGIC       0x46575550U     // "FWUP"
+
+/* Record in the META page; magic_inv guards against a half-written page */
+struct fw_meta {
+    u32_t magic;
+    u32_t size;
+    u32_t crc;
+    u32_t magic_inv;
+};
+
+static struct {
+    uint8_t active;
+    u32_t size;             // Announced image size
+    u32_t expected_crc;
+    u32_t crc;              // Running CRC of everything received
+    u32_t written;          // Bytes programmed (multiple of 8)
+    uint8_t carry[8];       // Bytes waiting to complete a double-word
+    uint8_t carry_len;
+} fw;
+
+/* CRC-32 (reflected 0xEDB88320), 4 bits at a time: 64 bytes of table */
+static const u32_t fw_crc_nibble[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+static u32_t fw_crc32(u32_t crc, const uint8_t *data, u32_t len)
+{
+    crc = ~crc;
+    while (len--)
+    {
+        crc ^= *data++;
+        crc = (crc >> 4) ^ fw_crc_nibble[crc & 0x0F];
+        crc = (crc >> 4) ^ fw_crc_nibble[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+static err_t fw_erase_page(u32_t addr)
+{
+    FLASH_EraseInitTypeDef erase;
+    uint32_t page_err;
+
+    erase.TypeErase = FLASH_TYPEERASE_PAGES;
+    erase.Banks = FLASH_BANK_1;
+    erase.Page = (addr - FLASH_BASE) / FLASH_PAGE_SIZE;
+    erase.NbPages = 1;
+
+    return (HAL_FLASHEx_Erase(&erase, &page_err) == HAL_OK) ? ERR_OK : ERR_IF;
+}
+
+/* Program one double-word of the staging slot at fw.written */
+static err_t fw_program(const uint8_t *dw)
+{
+    u32_t addr = FW_STAGING_ADDR + fw.written;
+    uint64_t data;
+
+    // First write into a page: erase it now rather than all 31 pages up front
+    if ((addr % FLASH_PAGE_SIZE) == 0 && fw_erase_page(addr) != ERR_OK)
+    {
+        return ERR_IF;
+    }
+
+    memcpy(&data, dw, sizeof(data));
+    if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, addr, data) != HAL_OK)
+    {
+        return ERR_IF;
+    }
+    fw.written += 8;
+    return ERR_OK;
+}
+
+err_t fw_update_begin(u32_t size, u32_t crc)
+{
+    if (fw.active)
+    {
+        return ERR_INPROGRESS;
+    }
+    if (size == 0 || size > FW_SLOT_SIZE)
+    {
+        return ERR_VAL;
+    }
+
+    memset(&fw, 0, sizeof(fw));
+    fw.active = 1;
+    fw.size = size;
+    fw.expected_crc = crc;
+
+    HAL_FLASH_Unlock();
+    return ERR_OK;
+}
+
+err_t fw_update_write(const struct pbuf *p, u16_t offset, u16_t len)
+{
+    const struct pbuf *q;
+
+    if (!fw.active)
+    {
+        return ERR_VAL;
+    }
+    if (fw.written + fw.carry_len + len > fw.size)
+    {
+        return ERR_VAL;
+    }
+
+    for (q = p; q != NULL && len > 0; q = q->next)
+    {
+        const uint8_t *src;
+        u16_t n;
+
+        if (offset >= q->len)
+        {
+            offset -= q->len;
+            continue;
+        }
+        src = (const uint8_t *)q->payload + offset;
+        n = (u16_t)LWIP_MIN(q->len - offset, len);
+        offset = 0;
+        len -= n;
+
+        fw.crc = fw_crc32(fw.crc, src, n);
+
+        while (n > 0)
+        {
+            // Straight from the pbuf when aligned with a double-word boundary
+            if (fw.carry_len == 0 && n >= 8)
+            {
+                if (fw_program(src) != ERR_OK) return ERR_IF;
+                src += 8;
+                n -= 8;
+                continue;
+            }
+
+            fw.carry[fw.carry_len++] = *src++;
+            n--;
+            if (fw.carry_len == 8)
+            {
+                fw.carry_len = 0;
+                if (fw_program(fw.carry) != ERR_OK) return ERR_IF;
+            }
+        }
+    }
+    return ERR_OK;
+}
+
+static void fw_update_reboot(void *arg)
+{
+    LWIP_UNUSED_ARG(arg);
+    NVIC_SystemReset();
+}
+
+err_t fw_update_finish(void)
+{
+    struct fw_meta meta;
+    uint64_t dw[2];
+    err_t err = ERR_OK;
+
+    if (!fw.active)
+    {
+        return ERR_VAL;
+    }
+
+    // 1. Tail: pad the last double-word with erased-flash bytes
+    if (fw.carry_len > 0)
+    {
+        memset(fw.carry + fw.carry_len, 0xFF, 8 - fw.carry_len);
+        fw.carry_len = 0;
+        err = fw_program(fw.carry);
+    }
+
+    // 2. Verify what actually landed in flash, not just what we received
+    if (err == ERR_OK &&
+        (fw.crc != fw.expected_crc ||
+         fw_crc32(0, (const uint8_t *)FW_STAGING_ADDR, fw.size) != fw.expected_crc))
+    {
+        err = ERR_VAL;
+    }
+
+    // 3. Mark it pending for the boot copier
+    if (err == ERR_OK)
+    {
+        meta.magic = FW_META_MAGIC;
+        meta.size = fw.size;
+        meta.crc = fw.expected_crc;
+        meta.magic_inv = ~FW_META_MAGIC;
+        memcpy(dw, &meta, sizeof(meta));
+
+        if (fw_erase_page(FW_META_ADDR) != ERR_OK ||
+            HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, FW_META_ADDR, dw[0]) != HAL_OK ||
+            HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, FW_META_ADDR + 8, dw[1]) != HAL_OK)
+        {
+            err = ERR_IF;
+        }
+    }
+
+    HAL_FLASH_Lock();
+    fw.active = 0;
+
+    if (err == ERR_OK)
+    {
+        // Leave time for the reply to reach the client
+        sys_timeout(FW_REBOOT_DELAY_MS, fw_update_reboot, NULL);
+    }
+    return err;
+}
+
+void fw_update_abort(void)
+{
+    if (fw.active)
+    {
+        HAL_FLASH_Lock();
+        fw.active = 0;
+    }
+}
+
+u32_t fw_update_received(void)
+{
+    return fw.written + fw.carry_len;
+}
+
+/* Busy-wait for the flash controller; macro so nothing is called from RAM code */
+#define FW_RAM_WAIT()   while (FLASH->SR & (FLASH_SR_BSY1 | FLASH_SR_CFGBSY)) { }
+
+/*
+ * Copies the staging slot over the application and resets.
+ * Lives in RAM (.RamFunc, copied by the startup code along with .data) because
+ * it erases the flash the application runs from. It must not call anything
+ * that lives in flash: only registers, CMSIS force-inlined intrinsics and
+ * shifts (no division, which could pull in a libgcc helper).
+ */
+__attribute__((section(".RamFunc"), noinline, long_call, noreturn))
+static void fw_swap_ram(u32_t size)
+{
+    u32_t pages = (size + FLASH_PAGE_SIZE - 1U) >> 11; // FLASH_PAGE_SIZE == 2 KB
+    u32_t page, i;
+
+    __disable_irq(); // The vector table is about to disappear
+
+    if (FLASH->CR & FLASH_CR_LOCK)
+    {
+        FLASH->KEYR = FLASH_KEY1;
+        FLASH->KEYR = FLASH_KEY2;
+    }
+
+    for (page = 0; page <= pages; page++)
+    {
+        // The last round erases the META page so this runs only once
+        u32_t dst = (page < pages) ? FW_APP_ADDR + (page << 11) : FW_META_ADDR;
+        u32_t src = FW_STAGING_ADDR + (page << 11);
+
+        FW_RAM_WAIT();
+        FLASH->SR = FLASH_SR_ERRORS;
+        FLASH->CR = FLASH_CR_PER | (((dst - FLASH_BASE) >> 11) << FLASH_CR_PNB_Pos);
+        FLASH->CR |= FLASH_CR_STRT;
+        FW_RAM_WAIT();
+
+        if (page == pages) break;
+
+        FLASH->CR = FLASH_CR_PG;
+        for (i = 0; i < FLASH_PAGE_SIZE; i += 8)
+        {
+            *(volatile u32_t *)(dst + i) = *(const volatile u32_t *)(src + i);
+            __ISB();
+            *(volatile u32_t *)(dst + i + 4) = *(const volatile u32_t *)(src + i + 4);
+            FW_RAM_WAIT();
+        }
+    }
+    FLASH->CR = FLASH_CR_LOCK;
+
+    // NVIC_SystemReset() is not guaranteed to be inlined: do it by hand
+    __DSB();
+    SCB->AIRCR = (0x5FAUL << SCB_AIRCR_VECTKEY_Pos) | SCB_AIRCR_SYSRESETREQ_Msk;
+    __DSB();
+    for (;;) { }
+}
+
+void fw_update_boot_check(void)
+{
+    const struct fw_meta *meta = (const struct fw_meta *)FW_META_ADDR;
+
+    if (meta->magic != FW_META_MAGIC || meta->magic_inv != ~FW_META_MAGIC)
+    {
+        return; // Nothing staged (erased page reads 0xFFFFFFFF)
+    }
+
+    // Re-check the image: never install something that rotted in the meantime
+    if (meta->size == 0 || meta->size > FW_SLOT_SIZE ||
+        fw_crc32(0, (const uint8_t *)FW_STAGING_ADDR, meta->size) != meta->crc)
+    {
+        HAL_FLASH_Unlock();
+        fw_erase_page(FW_META_ADDR);
+        HAL_FLASH_Lock();
+        return;
+    }
+
+    fw_swap_ram(meta->size);
+}
+
+#endif /* FW_UPDATE_ENABLE */
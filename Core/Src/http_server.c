@@ -1,19 +1,104 @@
 #include "http_server.h"
+#include "http_sse.h"
+#include "http_ws.h"
+#include "cmd_exec.h"
+#include "cmd_queue.h"
 #include "webpage.h"
-#include "main.h" // For LED_BLUE_Pin definitions
+#include "metrics.h"
+#include "net_stats.h"
+#include "mem_watch.h"
+#include "self_bench.h"
+#include "rate_limit.h"
+#include "fw_update.h"
+#include "status_cache.h"
+#include "http_tmpl.h"
+#include "enc_cache.h"
+#include "asset_chksum.h"
 #include "lwip/debug.h"
 #include "lwip/stats.h"
 #include "lwip/tcp.h"
+#include "lwip/netif.h"
+#include "lwip/sys.h"
 #include "lwip/err.h"   // <--- This fixes 'unknown type name err_t'
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
 
 /* The Server Control Block */
 static struct tcp_pcb *http_pcb;
 
+/* Connection stages timestamped for /metrics */
+enum http_stage {
+    HTTP_T_ACCEPT = 0,
+    HTTP_T_FIRST_BYTE,
+    HTTP_T_REQ_DONE,
+    HTTP_T_RESP_QUEUED,
+    HTTP_T_LAST_ACK,
+    HTTP_T_CLOSED,
+    HTTP_T_COUNT
+};
+
+/* Renders the next piece of a generated body into buf; 0 when finished */
+typedef u16_t (*http_gen_fn)(uint16_t *cursor, char *buf, u16_t size);
+
+/* Largest piece a body generator is asked for at a time */
+#define HTTP_GEN_CHUNK  128
+
+#if HTTP_GEN_CHUNK < METRICS_RENDER_MAX || HTTP_GEN_CHUNK < NET_STATS_RENDER_MAX || \
+    HTTP_GEN_CHUNK < RATE_LIMIT_RENDER_MAX || HTTP_GEN_CHUNK < MEM_WATCH_RENDER_MAX || \
+    HTTP_GEN_CHUNK < SELF_BENCH_RENDER_MAX
+#error "HTTP_GEN_CHUNK must hold the longest piece of every body generator"
+#endif
+
+/* Pool pbufs kept free for established connections before we start resetting */
+#define HTTP_POOL_RESERVE   4
+
+/* Slowloris protection: deadlines checked from the poll timer */
+#define HTTP_POLL_INTERVAL  2       // tcp_poll units (500 ms): 1s resolution
+#define HTTP_FIRST_BYTE_MS  3000    // accept -> first request byte
+#define HTTP_HEADERS_MS     5000    // accept -> empty line ending the headers
+#define HTTP_BODY_WINDOW_MS 2000    // Body rate is measured over windows this long
+#define HTTP_BODY_MIN_BPS   256     // ...and must average at least this many bytes/s
+#define HTTP_DRAIN_POLLS    8       // Polls without ACK progress before a response is dropped
+
+/* Largest request (headers + small body) assembled in RAM before routing */
+#define HTTP_REQ_MAX        1024
+
+/* Received pbufs a connection may hold while assembling; past that the chain
+   is copied into one heap pbuf, so tiny segments can't pin the whole pool */
+#define HTTP_REQ_PBUFS      3
+
+static const char http_429[] =
+"HTTP/1.1 429 Too Many Requests\r\nRetry-After: 1\r\nContent-Length: 0\r\n\r\n";
+
+static const char http_cmd_ok[] =
+"HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n\r\n{\"status\":\"ok\"}";
+
+static const char http_json_hdr[] =
+"HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nCache-Control: no-cache\r\n\r\n";
+
 /* Structure to track connection state (reused from echo example) */
 struct http_state {
     uint8_t retries;
+    uint8_t closing;    // tcp_close() issued, waiting for the last ACK
+    uint8_t stamped;    // One bit per stage already timestamped
+    uint8_t throttled;  // Client is over its rate budget
+    uint8_t tmpl;       // data is a template: expand <!--#tag--> markers while sending
+    uint8_t upload;     // Request body is a firmware image being streamed to flash
+    uint8_t headers;    // Header block complete
+    u32_t body_left;    // Image bytes still to come
+    struct pbuf *req;   // Request assembled so far, until it can be routed
+    u32_t accept_ms;    // sys_now() at accept, for the header deadlines
+    u32_t rx_bytes;     // Request bytes received so far
+    u32_t rate_ms;      // Start of the current body-rate window...
+    u32_t rate_bytes;   // ...and rx_bytes at that point
+    const char *data;   // Remaining response bytes (flash-resident)
+    u16_t left;
+    http_gen_fn gen;    // Generated body, sent after data; NULL when none
+    uint16_t cursor;    // Generator position
+    u32_t end_seq;      // Sequence number just past the last response byte
+    uint32_t t[HTTP_T_COUNT];
 };
 
 /* Forward declarations */
@@ -21,7 +106,25 @@ static err_t http_accept(void *arg, struct tcp_pcb *newpcb, err_t err);
 static err_t http_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
 static void http_conn_err(void *arg, err_t err);
 static err_t http_poll(void *arg, struct tcp_pcb *tpcb);
+static err_t http_sent(void *arg, struct tcp_pcb *tpcb, u16_t len);
+static void http_send_data(struct tcp_pcb *tpcb, struct http_state *hs);
 static void http_close(struct tcp_pcb *tpcb, struct http_state *hs);
+static void http_release(struct tcp_pcb *tpcb, struct http_state *hs);
+static void http_stamp(struct http_state *hs, uint8_t stage);
+static void http_finish(struct http_state *hs);
+static uint8_t http_resources_critical(void);
+static const char *http_header(const char *req, u16_t len, const char *name);
+static void http_send_json_header(struct http_state *hs, http_gen_fn gen);
+#if FW_UPDATE_ENABLE
+static void http_fw_begin(struct tcp_pcb *tpcb, struct http_state *hs, struct pbuf *p);
+static void http_fw_data(struct tcp_pcb *tpcb, struct http_state *hs, struct pbuf *p, u16_t offset);
+static void http_fw_reply(struct tcp_pcb *tpcb, struct http_state *hs, const char *status, const char *body);
+#endif
+static void http_req_error(struct tcp_pcb *tpcb, struct http_state *hs, const char *resp);
+static err_t http_deadline_abort(struct tcp_pcb *tpcb, metric_counter_t which);
+static u16_t http_tag_led(char *buf, u16_t size);
+static u16_t http_tag_ip(char *buf, u16_t size);
+static u16_t http_tag_uptime(char *buf, u16_t size);
 
 /**
  * @brief  Initializes the HTTP server on Port 80
@@ -46,15 +149,40 @@ void http_server_init(void)
             memp_free(MEMP_TCP_PCB, http_pcb);
         }
     }
+
+    // Live values for the templated pages
+    http_tmpl_register("led", http_tag_led);
+    http_tmpl_register("ip", http_tag_ip);
+    http_tmpl_register("uptime", http_tag_uptime);
+
+    // Constant responses sent without copying: keep them in ENC SRAM so the
+    // driver DMA-copies them instead of clocking them over SPI every time
+    enc_cache_add(http_cmd_ok, sizeof(http_cmd_ok) - 1);
+    enc_cache_add(http_429, sizeof(http_429) - 1);
+    enc_cache_add(index_html, sizeof(index_html) - 1);
+
+    // ...and their TCP checksums are taken from precomputed chunk sums
+    asset_chksum_register(http_cmd_ok, sizeof(http_cmd_ok) - 1);
+    asset_chksum_register(http_429, sizeof(http_429) - 1);
+    asset_chksum_register(index_html, sizeof(index_html) - 1);
 }
 
 static err_t http_accept(void *arg, struct tcp_pcb *newpcb, err_t err)
 {
     struct http_state *hs;
+    rate_verdict_t verdict;
 
     LWIP_UNUSED_ARG(arg);
     LWIP_UNUSED_ARG(err);
 
+    // Per-client budget, so one busy client can't hold every PCB and pbuf
+    verdict = rate_limit_check(ip_addr_get_ip4_u32(&newpcb->remote_ip), http_resources_critical());
+    if (verdict == RATE_REJECT)
+    {
+        tcp_abort(newpcb); // RST: costs nothing to keep around
+        return ERR_ABRT;
+    }
+
     // Set priority for the connection
     tcp_setprio(newpcb, TCP_PRIO_MIN);
 
@@ -62,15 +190,19 @@ static err_t http_accept(void *arg, struct tcp_pcb *newpcb, err_t err)
     hs = (struct http_state *)mem_malloc(sizeof(struct http_state));
     if (hs != NULL)
     {
-        hs->retries = 0;
+        memset(hs, 0, sizeof(*hs));
+        hs->throttled = (verdict == RATE_THROTTLE);
+        hs->accept_ms = sys_now();
+        http_stamp(hs, HTTP_T_ACCEPT);
 
         // Pass 'hs' as the callback argument
         tcp_arg(newpcb, hs);
 
         // Register the Callbacks
         tcp_recv(newpcb, http_recv);
+        tcp_sent(newpcb, http_sent);
         tcp_err(newpcb, http_conn_err);
-        tcp_poll(newpcb, http_poll, 4); // Poll every 2s
+        tcp_poll(newpcb, http_poll, HTTP_POLL_INTERVAL);
 
         return ERR_OK;
     }
@@ -84,6 +216,9 @@ static err_t http_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t er
 {
     struct http_state *hs = (struct http_state *)arg;
     char *data;
+    const char *cl;
+    u16_t hdr_end;
+    u32_t need;
 
     if (p == NULL)
     {
@@ -98,37 +233,301 @@ static err_t http_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t er
         return err;
     }
 
+    http_stamp(hs, HTTP_T_FIRST_BYTE);
+    hs->rx_bytes += p->tot_len;
+
+#if FW_UPDATE_ENABLE
+    // Firmware body in progress: every segment goes to flash
+    if (hs->upload)
+    {
+        http_fw_data(tpcb, hs, p, 0);
+        return ERR_OK;
+    }
+#endif
+
+    // Still draining the previous response: swallow anything extra
+    if (hs->left > 0 || hs->gen != NULL)
+    {
+        tcp_recved(tpcb, p->tot_len);
+        pbuf_free(p);
+        return ERR_OK;
+    }
+
+    // Over its rate budget: canned 429, no parsing and no handler work
+    if (hs->throttled)
+    {
+        hs->data = http_429;
+        hs->left = sizeof(http_429) - 1;
+        tcp_recved(tpcb, p->tot_len);
+        pbuf_free(p);
+        http_send_data(tpcb, hs);
+        return ERR_OK;
+    }
+
+    // --- REQUEST ASSEMBLY ---
+    // Segments are held (and the window not reopened) until the request is
+    // complete; a client dripping it in runs into the deadlines in http_poll()
+    if (hs->req == NULL) hs->req = p;
+    else pbuf_cat(hs->req, p);
+    p = hs->req;
+
+    if (pbuf_clen(p) > HTTP_REQ_PBUFS)
+    {
+        p = hs->req = pbuf_coalesce(p, PBUF_RAW);
+        if (p->next != NULL)
+        {
+            http_req_error(tpcb, hs, "HTTP/1.1 503 Service Unavailable\r\nRetry-After: 1\r\n\r\n");
+            return ERR_OK;
+        }
+    }
+
+    hdr_end = pbuf_memfind(p, "\r\n\r\n", 4, 0);
+    if (hdr_end == 0xFFFF)
+    {
+        if (p->tot_len >= HTTP_REQ_MAX)
+        {
+            http_req_error(tpcb, hs, "HTTP/1.1 431 Request Header Fields Too Large\r\n\r\n");
+        }
+        return ERR_OK;
+    }
+    if (!hs->headers)
+    {
+        hs->headers = 1;
+        hs->rate_ms = sys_now();
+        hs->rate_bytes = hs->rx_bytes;
+    }
+
+    // The parser wants the header block in one piece
+    if (p->len < hdr_end + 4)
+    {
+        p = hs->req = pbuf_coalesce(p, PBUF_RAW);
+        if (p->next != NULL)
+        {
+            http_req_error(tpcb, hs, "HTTP/1.1 503 Service Unavailable\r\nRetry-After: 1\r\n\r\n");
+            return ERR_OK;
+        }
+    }
+
+    // Small bodies are assembled too (a firmware image is streamed instead)
+    if (pbuf_memcmp(p, 0, "POST /api/firmware", 18) != 0)
+    {
+        cl = http_header((const char *)p->payload, p->len, "Content-Length:");
+        need = hdr_end + 4U + (cl ? strtoul(cl, NULL, 10) : 0);
+
+        if (need > HTTP_REQ_MAX)
+        {
+            http_req_error(tpcb, hs, "HTTP/1.1 413 Payload Too Large\r\n\r\n");
+            return ERR_OK;
+        }
+        if (need > p->tot_len)
+        {
+            return ERR_OK; // Body still coming, paced by HTTP_BODY_MIN_BPS
+        }
+        if (p->next != NULL)
+        {
+            p = hs->req = pbuf_coalesce(p, PBUF_RAW);
+            if (p->next != NULL)
+            {
+                http_req_error(tpcb, hs, "HTTP/1.1 503 Service Unavailable\r\nRetry-After: 1\r\n\r\n");
+                return ERR_OK;
+            }
+        }
+    }
+    hs->req = NULL; // Ours to route and free from here on
+
     // --- HTTP PARSER LOGIC ---
 
-    // 1. Point to the payload
+    // 1. Point to the payload (headers and any small body are contiguous)
     data = (char *)p->payload;
+    http_stamp(hs, HTTP_T_REQ_DONE);
 
     // 2. Check for GET Request (Load Page)
     if (strncmp(data, "GET / ", 6) == 0 || strncmp(data, "GET /index.html", 15) == 0)
     {
-        // Send the HTML page from webpage.h
-        tcp_write(tpcb, index_html, sizeof(index_html)-1, TCP_WRITE_FLAG_COPY);
+        // The page is bigger than TCP_SND_BUF: queue it from flash and
+        // let http_sent() feed the rest as ACKs free up the send buffer.
+        // Its <!--#tag--> markers are filled in on the way out.
+        hs->data = index_html;
+        hs->left = sizeof(index_html) - 1;
+        hs->tmpl = 1;
+    }
+    // 3. Server-Sent Events stream (connection stays open)
+    else if (strncmp(data, "GET /events", 11) == 0)
+    {
+        tcp_recved(tpcb, p->tot_len);
+        pbuf_free(p);
+
+        // The SSE module owns the pcb from here on: detach and finish our state
+        http_release(tpcb, hs);
+        if (http_sse_subscribe(tpcb) != ERR_OK)
+        {
+            char resp[] = "HTTP/1.1 503 Service Unavailable\r\n\r\n";
+            tcp_write(tpcb, resp, strlen(resp), TCP_WRITE_FLAG_COPY);
+            tcp_output(tpcb);
+            http_close(tpcb, NULL);
+            return ERR_OK;
+        }
+
+        // Tell the new subscriber (and everyone else) the current state
+        http_sse_publish("led", cmd_led_json());
+        return ERR_OK;
+    }
+    // 4. WebSocket command channel (connection stays open)
+    else if (strncmp(data, "GET /ws ", 8) == 0)
+    {
+        err_t ws_err = http_ws_upgrade(tpcb, data, p->len);
+
+        tcp_recved(tpcb, p->tot_len);
+        pbuf_free(p);
+
+        if (ws_err == ERR_OK)
+        {
+            // The WebSocket module owns the pcb (and its callbacks) from here on
+            http_finish(hs);
+            return ERR_OK;
+        }
+
+        const char *resp = (ws_err == ERR_MEM) ? "HTTP/1.1 503 Service Unavailable\r\n\r\n"
+                                               : "HTTP/1.1 400 Bad Request\r\n\r\n";
+        tcp_write(tpcb, resp, strlen(resp), 0);
+        http_send_data(tpcb, hs);
+        return ERR_OK;
     }
-    // 3. Check for POST Request (Button Press)
+    // 5. Check for POST Request (Button Press)
     else if (strncmp(data, "POST /api/cmd", 13) == 0)
     {
-        // Simple String Search for JSON (Not robust, but fast for MVP)
-        if (strstr(data, "\"cmd\":\"ON\""))
+        cmd_execute(cmd_parse(data, p->len));
+
+        // Send 200 OK (constant, referenced rather than copied: see enc_cache)
+        hs->data = http_cmd_ok;
+        hs->left = sizeof(http_cmd_ok) - 1;
+    }
+    // 6. Batched commands, applied together once all of them validate
+    else if (strncmp(data, "POST /api/batch", 15) == 0)
+    {
+        cmd_item_t items[CMD_BATCH_MAX];
+        char resp[128];
+        int n = cmd_batch_parse(data, p->len, items);
+
+        if (n > 0)
         {
-            // Turn LED ON (Using the pin name from your project)
-            // Adjust LED_BLUE_GPIO_Port if your board uses LD2 or PA5
-            HAL_GPIO_WritePin(LED_BLUE_GPIO_Port, LED_BLUE_Pin, GPIO_PIN_SET);
+            cmd_batch_execute(items, (uint8_t)n);
+            snprintf(resp, sizeof(resp),
+                     "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n\r\n"
+                     "{\"status\":\"ok\",\"applied\":%d,%s", n, cmd_led_json() + 1);
         }
-        else if (strstr(data, "\"cmd\":\"OFF\""))
+        else
         {
-            // Turn LED OFF
-            HAL_GPIO_WritePin(LED_BLUE_GPIO_Port, LED_BLUE_Pin, GPIO_PIN_RESET);
+            // Nothing was applied: report the first bad entry
+            snprintf(resp, sizeof(resp),
+                     "HTTP/1.1 400 Bad Request\r\nContent-Type: application/json\r\n\r\n"
+                     "{\"status\":\"error\",\"index\":%d}", (n < 0) ? -n - 1 : 0);
         }
+        tcp_write(tpcb, resp, strlen(resp), TCP_WRITE_FLAG_COPY);
+    }
+    // 7. Queued job: reply 202 right away, the main loop does the work
+    else if (strncmp(data, "POST /api/jobs", 14) == 0)
+    {
+        cmd_item_t items[CMD_BATCH_MAX];
+        char resp[160];
+        int n = cmd_batch_parse(data, p->len, items);
+        int id = (n > 0) ? cmd_queue_submit(items, (uint8_t)n) : 0;
 
-        // Send 200 OK
-        char resp[] = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n\r\n{\"status\":\"ok\"}";
+        if (id > 0)
+        {
+            snprintf(resp, sizeof(resp),
+                     "HTTP/1.1 202 Accepted\r\nContent-Type: application/json\r\n"
+                     "Location: /api/jobs/%d\r\n\r\n{\"job\":%d}", id, id);
+        }
+        else if (id < 0)
+        {
+            snprintf(resp, sizeof(resp), "HTTP/1.1 503 Service Unavailable\r\nRetry-After: 1\r\n\r\n");
+        }
+        else
+        {
+            snprintf(resp, sizeof(resp),
+                     "HTTP/1.1 400 Bad Request\r\nContent-Type: application/json\r\n\r\n"
+                     "{\"status\":\"error\",\"index\":%d}", (n < 0) ? -n - 1 : 0);
+        }
         tcp_write(tpcb, resp, strlen(resp), TCP_WRITE_FLAG_COPY);
     }
+    // 8. Job status
+    else if (strncmp(data, "GET /api/jobs/", 14) == 0)
+    {
+        char resp[160];
+        uint16_t id = 0;
+        uint8_t step = 0, steps = 0;
+        u16_t i;
+        cmd_job_state_t state;
+
+        for (i = 14; i < p->len && data[i] >= '0' && data[i] <= '9'; i++)
+        {
+            id = (uint16_t)(id * 10 + (data[i] - '0'));
+        }
+
+        state = cmd_queue_status(id, &step, &steps);
+        if (state != JOB_UNKNOWN)
+        {
+            snprintf(resp, sizeof(resp),
+                     "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n\r\n"
+                     "{\"job\":%u,\"state\":\"%s\",\"step\":%u,\"steps\":%u}",
+                     id, cmd_queue_state_name(state), step, steps);
+        }
+        else
+        {
+            snprintf(resp, sizeof(resp), "HTTP/1.1 404 Not Found\r\n\r\n");
+        }
+        tcp_write(tpcb, resp, strlen(resp), TCP_WRITE_FLAG_COPY);
+    }
+    // 9. Latency histograms (Prometheus text format), rendered while sending
+    else if (strncmp(data, "GET /metrics", 12) == 0)
+    {
+        static const char hdr[] =
+            "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+            "Connection: close\r\n\r\n";
+        hs->data = hdr;
+        hs->left = sizeof(hdr) - 1;
+        hs->gen = metrics_render;
+        hs->cursor = 0;
+    }
+    // 10. lwIP counters and pool high-water marks (JSON)
+    else if (strncmp(data, "GET /api/stats", 14) == 0)
+    {
+        http_send_json_header(hs, net_stats_render);
+    }
+    // 11. Per-client rate limiter counters (JSON)
+    else if (strncmp(data, "GET /api/clients", 16) == 0)
+    {
+        http_send_json_header(hs, rate_limit_render);
+    }
+#if FW_UPDATE_ENABLE
+    // 12. Firmware image, streamed into the staging slot as it arrives.
+    //     Unauthenticated: only built with FW_UPDATE_ENABLE (see fw_update.c)
+    else if (strncmp(data, "POST /api/firmware", 18) == 0)
+    {
+        http_fw_begin(tpcb, hs, p);
+        return ERR_OK;
+    }
+#endif
+    // 13. Device status: cached render, 304 when the client already has it
+    else if (strncmp(data, "GET /api/status", 15) == 0)
+    {
+        const char *inm = http_header(data, p->len, "If-None-Match:");
+        u16_t len;
+        const char *resp = status_cache_get(inm, inm ? (u16_t)(p->len - (inm - data)) : 0, &len);
+
+        tcp_write(tpcb, resp, len, TCP_WRITE_FLAG_COPY);
+    }
+    // 14. RAM high-water marks: stack, newlib heap, lwIP pools (JSON)
+    else if (strncmp(data, "GET /api/mem", 12) == 0)
+    {
+        http_send_json_header(hs, mem_watch_render);
+    }
+    // 15. Self-benchmark of SPI, ENC SRAM, checksum and frame path (JSON, blocks a few ms)
+    else if (strncmp(data, "GET /api/bench", 14) == 0)
+    {
+        http_send_json_header(hs, self_bench_render);
+    }
     else
     {
         // 404 Not Found
@@ -136,22 +535,269 @@ static err_t http_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t er
         tcp_write(tpcb, resp, strlen(resp), TCP_WRITE_FLAG_COPY);
     }
 
-    // 4. Send immediately
-    tcp_output(tpcb);
-
-    // 5. Advertise window size (We read the data)
+    // 16. Advertise window size (We read the data)
     tcp_recved(tpcb, p->tot_len);
 
-    // 6. Free the buffer
+    // 17. Free the buffer
     pbuf_free(p);
 
-    // 7. Close connection (Simple HTTP 1.0 style)
-    http_close(tpcb, hs);
+    // 18. Send immediately, close once everything is queued (Simple HTTP 1.0 style)
+    http_send_data(tpcb, hs);
 
     return ERR_OK;
 }
 
+/* 200 with the no-cache JSON header from flash; gen renders the body after it */
+static void http_send_json_header(struct http_state *hs, http_gen_fn gen)
+{
+    hs->data = http_json_hdr;
+    hs->left = sizeof(http_json_hdr) - 1;
+    hs->gen = gen;
+    hs->cursor = 0;
+}
+
+/* Value of a request header (name given with its ':', any case), or NULL */
+static const char *http_header(const char *req, u16_t len, const char *name)
+{
+    u16_t nlen = (u16_t)strlen(name);
+    u16_t i;
+
+    for (i = 0; i + nlen < len; i++)
+    {
+        if (i > 0 && req[i - 1] != '\n') continue;
+        if (req[i] == '\r') break; // Empty line: end of headers
+
+        if (strncasecmp(&req[i], name, nlen) == 0)
+        {
+            i += nlen;
+            while (i < len && req[i] == ' ') i++;
+            return &req[i];
+        }
+    }
+    return NULL;
+}
+
+/* Drop the request assembled so far and answer with a canned error */
+static void http_req_error(struct tcp_pcb *tpcb, struct http_state *hs, const char *resp)
+{
+    tcp_recved(tpcb, hs->req->tot_len);
+    pbuf_free(hs->req);
+    hs->req = NULL;
+
+    tcp_write(tpcb, resp, strlen(resp), 0); // String literal: no copy
+    http_send_data(tpcb, hs);
+}
+
+#if FW_UPDATE_ENABLE
+/* POST /api/firmware: headers sit in the first segment, the body may start there too */
+static void http_fw_begin(struct tcp_pcb *tpcb, struct http_state *hs, struct pbuf *p)
+{
+    const char *req = (const char *)p->payload;
+    const char *cl = http_header(req, p->len, "Content-Length:");
+    const char *crc = http_header(req, p->len, "X-Firmware-CRC32:");
+    u16_t hdr_end = pbuf_memfind(p, "\r\n\r\n", 4, 0);
+    u32_t size;
+    err_t err;
+
+    if (cl == NULL || crc == NULL || hdr_end == 0xFFFF)
+    {
+        tcp_recved(tpcb, p->tot_len);
+        pbuf_free(p);
+        http_fw_reply(tpcb, hs, "400 Bad Request", "\"Content-Length and X-Firmware-CRC32 required\"");
+        return;
+    }
+
+    size = strtoul(cl, NULL, 10);
+    err = fw_update_begin(size, strtoul(crc, NULL, 16));
+    if (err != ERR_OK)
+    {
+        tcp_recved(tpcb, p->tot_len);
+        pbuf_free(p);
+        if (err == ERR_INPROGRESS)
+            http_fw_reply(tpcb, hs, "409 Conflict", "\"upload in progress\"");
+        else
+            http_fw_reply(tpcb, hs, "413 Payload Too Large", "\"image does not fit the staging slot\"");
+        return;
+    }
+
+    // The request is only complete once the whole body is in
+    hs->stamped &= (uint8_t)~(1U << HTTP_T_REQ_DONE);
+    hs->upload = 1;
+    hs->body_left = size;
+    http_fw_data(tpcb, hs, p, (u16_t)(hdr_end + 4));
+}
+
+/* Program the image bytes of one segment, then let the sender have the window back */
+static void http_fw_data(struct tcp_pcb *tpcb, struct http_state *hs, struct pbuf *p, u16_t offset)
+{
+    err_t err = ERR_OK;
+    u16_t n = 0;
+
+    if (p->tot_len > offset)
+    {
+        n = (u16_t)LWIP_MIN((u32_t)(p->tot_len - offset), hs->body_left);
+        err = fw_update_write(p, offset, n);
+        hs->body_left -= n;
+    }
+
+    // fw_update_write() programs synchronously, so the bytes are in flash
+    // by now. The window is reopened right away; the sender is only held
+    // back by the time this callback spends programming
+    tcp_recved(tpcb, p->tot_len);
+    pbuf_free(p);
+
+    if (err != ERR_OK)
+    {
+        fw_update_abort();
+        hs->upload = 0;
+        http_fw_reply(tpcb, hs, "500 Internal Server Error", "\"flash write failed\"");
+    }
+    else if (hs->body_left == 0)
+    {
+        hs->upload = 0;
+        http_stamp(hs, HTTP_T_REQ_DONE);
+
+        err = fw_update_finish();
+        if (err == ERR_OK)
+            http_fw_reply(tpcb, hs, "200 OK", "\"installing, rebooting\"");
+        else if (err == ERR_VAL)
+            http_fw_reply(tpcb, hs, "422 Unprocessable Entity", "\"CRC mismatch\"");
+        else
+            http_fw_reply(tpcb, hs, "500 Internal Server Error", "\"flash write failed\"");
+    }
+}
+
+static void http_fw_reply(struct tcp_pcb *tpcb, struct http_state *hs, const char *status, const char *body)
+{
+    char resp[160];
+
+    snprintf(resp, sizeof(resp),
+             "HTTP/1.1 %s\r\nContent-Type: application/json\r\n\r\n"
+             "{\"status\":%s,\"received\":%lu}",
+             status, body, (unsigned long)fw_update_received());
+    tcp_write(tpcb, resp, strlen(resp), TCP_WRITE_FLAG_COPY);
+    http_send_data(tpcb, hs);
+}
+#endif /* FW_UPDATE_ENABLE */
+
+/* Queue as much of the pending response as the send buffer takes */
+static void http_send_data(struct tcp_pcb *tpcb, struct http_state *hs)
+{
+    while (hs->left > 0)
+    {
+        u16_t len = hs->left;
+        u16_t space = tcp_sndbuf(tpcb);
+
+        if (hs->tmpl)
+        {
+            // Text up to the next marker goes out by reference, the marker is expanded
+            len = http_tmpl_literal(hs->data, hs->left);
+            if (len == 0)
+            {
+                char buf[HTTP_GEN_CHUNK];
+                u16_t used, n;
+
+                if (space < sizeof(buf) || tcp_sndqueuelen(tpcb) >= TCP_SND_QUEUELEN) break;
+
+                n = http_tmpl_render(hs->data, hs->left, buf, sizeof(buf), &used);
+                if (n > 0 && tcp_write(tpcb, buf, n, TCP_WRITE_FLAG_COPY) != ERR_OK)
+                {
+                    break;
+                }
+                hs->data += used;
+                hs->left -= used;
+                continue;
+            }
+        }
+
+        if (len > space) len = space;
+        if (len == 0 || tcp_sndqueuelen(tpcb) >= TCP_SND_QUEUELEN) break;
+
+        // Flash data: reference it, no heap copy
+        if (tcp_write(tpcb, hs->data, len, 0) != ERR_OK)
+        {
+            break;
+        }
+        hs->data += len;
+        hs->left -= len;
+    }
+
+    // Generated body: rendered piece by piece into the send buffer (copied)
+    while (hs->left == 0 && hs->gen != NULL)
+    {
+        char buf[HTTP_GEN_CHUNK];
+        uint16_t prev = hs->cursor;
+        u16_t len;
+
+        if (tcp_sndbuf(tpcb) < sizeof(buf) || tcp_sndqueuelen(tpcb) >= TCP_SND_QUEUELEN) break;
+
+        len = hs->gen(&hs->cursor, buf, sizeof(buf));
+        if (len == 0)
+        {
+            hs->gen = NULL;
+            break;
+        }
+        if (tcp_write(tpcb, buf, len, TCP_WRITE_FLAG_COPY) != ERR_OK)
+        {
+            hs->cursor = prev; // Render the same piece again next time
+            break;
+        }
+    }
+
+    tcp_output(tpcb);
+
+    if (hs->left == 0 && hs->gen == NULL)
+    {
+        http_stamp(hs, HTTP_T_RESP_QUEUED);
+        http_close(tpcb, hs);
+    }
+}
+
+static err_t http_sent(void *arg, struct tcp_pcb *tpcb, u16_t len)
+{
+    struct http_state *hs = (struct http_state *)arg;
+    LWIP_UNUSED_ARG(len);
+
+    if (hs != NULL)
+    {
+        if (hs->closing)
+        {
+            // Already closed on our side: only waiting for the final ACK
+            if ((s32_t)(tpcb->lastack - hs->end_seq) >= 0)
+            {
+                http_release(tpcb, hs);
+            }
+            return ERR_OK;
+        }
+        hs->retries = 0;
+        http_send_data(tpcb, hs);
+    }
+    return ERR_OK;
+}
+
 static void http_close(struct tcp_pcb *tpcb, struct http_state *hs)
+{
+    tcp_recv(tpcb, NULL);
+    tcp_poll(tpcb, NULL, 0);
+
+    if (hs == NULL || (s32_t)(tpcb->lastack - tpcb->snd_lbb) >= 0)
+    {
+        // Nothing in flight
+        http_release(tpcb, hs);
+    }
+    else
+    {
+        // Keep the state (and tcp_sent) until the peer ACKs the last byte.
+        // If that never happens, lwIP gives up and reports it via tcp_err.
+        hs->closing = 1;
+        hs->end_seq = tpcb->snd_lbb;
+    }
+
+    tcp_close(tpcb);
+}
+
+/* Detach from the pcb and account the finished connection */
+static void http_release(struct tcp_pcb *tpcb, struct http_state *hs)
 {
     tcp_arg(tpcb, NULL);
     tcp_sent(tpcb, NULL);
@@ -159,21 +805,163 @@ static void http_close(struct tcp_pcb *tpcb, struct http_state *hs)
     tcp_err(tpcb, NULL);
     tcp_poll(tpcb, NULL, 0);
 
-    if (hs != NULL) mem_free(hs);
+    if (hs != NULL)
+    {
+        if (hs->stamped & (1U << HTTP_T_RESP_QUEUED))
+        {
+            http_stamp(hs, HTTP_T_LAST_ACK);
+        }
+        http_finish(hs);
+    }
+}
+
+static void http_stamp(struct http_state *hs, uint8_t stage)
+{
+    if (!(hs->stamped & (1U << stage)))
+    {
+        hs->t[stage] = metrics_now_us();
+        hs->stamped |= (uint8_t)(1U << stage);
+    }
+}
 
-    tcp_close(tpcb);
+/* Feed every stage interval we saw into the histograms, then free the state */
+static void http_finish(struct http_state *hs)
+{
+    // Same order as METRIC_HTTP_FIRST_BYTE .. METRIC_HTTP_TOTAL
+    static const uint8_t from[] = { HTTP_T_ACCEPT, HTTP_T_FIRST_BYTE, HTTP_T_REQ_DONE,
+                                    HTTP_T_RESP_QUEUED, HTTP_T_ACCEPT };
+    static const uint8_t to[]   = { HTTP_T_FIRST_BYTE, HTTP_T_REQ_DONE, HTTP_T_RESP_QUEUED,
+                                    HTTP_T_LAST_ACK, HTTP_T_CLOSED };
+    uint8_t i;
+
+    http_stamp(hs, HTTP_T_CLOSED);
+
+#if FW_UPDATE_ENABLE
+    // Connection lost mid-upload: the staging slot is simply left behind
+    if (hs->upload) fw_update_abort();
+#endif
+    if (hs->req != NULL) pbuf_free(hs->req);
+
+    for (i = 0; i < sizeof(from); i++)
+    {
+        uint8_t need = (uint8_t)((1U << from[i]) | (1U << to[i]));
+        if ((hs->stamped & need) == need)
+        {
+            metrics_observe((metric_id_t)(METRIC_HTTP_FIRST_BYTE + i), hs->t[to[i]] - hs->t[from[i]]);
+        }
+    }
+
+    mem_free(hs);
+}
+
+/* Template tags */
+static u16_t http_tag_led(char *buf, u16_t size)
+{
+    return (u16_t)snprintf(buf, size, "%s", cmd_led_state());
+}
+
+static u16_t http_tag_ip(char *buf, u16_t size)
+{
+    const ip4_addr_t *ip;
+
+    if (netif_default == NULL) return 0;
+    ip = netif_ip4_addr(netif_default);
+    return (u16_t)snprintf(buf, size, "%u.%u.%u.%u",
+                           ip4_addr1_16(ip), ip4_addr2_16(ip), ip4_addr3_16(ip), ip4_addr4_16(ip));
+}
+
+static u16_t http_tag_uptime(char *buf, u16_t size)
+{
+    return (u16_t)snprintf(buf, size, "%lu", (unsigned long)(sys_now() / 1000));
+}
+
+/* True when one more connection could starve the ones already being served */
+static uint8_t http_resources_critical(void)
+{
+#if MEMP_STATS
+    const struct stats_mem *pcbs = lwip_stats.memp[MEMP_TCP_PCB];
+    const struct stats_mem *pool = lwip_stats.memp[MEMP_PBUF_POOL];
+
+    // 'used' already includes the PCB being accepted
+    return (pcbs->used + 1 >= pcbs->avail) || (pool->used + HTTP_POOL_RESERVE >= pool->avail);
+#else
+    return 0;
+#endif
 }
 
 static void http_conn_err(void *arg, err_t err)
 {
     struct http_state *hs = (struct http_state *)arg;
     LWIP_UNUSED_ARG(err);
-    if (hs != NULL) mem_free(hs);
+
+    // PCB is already freed by lwIP
+    if (hs != NULL) http_finish(hs);
+}
+
+/* Deadline missed: count it and reset the connection (tcp_err frees the state) */
+static err_t http_deadline_abort(struct tcp_pcb *tpcb, metric_counter_t which)
+{
+    metrics_count(which);
+    tcp_abort(tpcb); // RST: the pcb is free right away, no FIN/TIME_WAIT
+    return ERR_ABRT;
 }
 
 static err_t http_poll(void *arg, struct tcp_pcb *tpcb)
 {
     struct http_state *hs = (struct http_state *)arg;
+    u32_t now = sys_now();
+
+    if (hs == NULL)
+    {
+        http_close(tpcb, hs);
+        return ERR_OK;
+    }
+
+    // 1. Nothing at all since accept
+    if (!(hs->stamped & (1U << HTTP_T_FIRST_BYTE)))
+    {
+        if (now - hs->accept_ms >= HTTP_FIRST_BYTE_MS)
+        {
+            return http_deadline_abort(tpcb, METRIC_CNT_DEADLINE_FIRST_BYTE);
+        }
+        return ERR_OK;
+    }
+
+    // 2. Headers trickling in
+    if (!hs->headers)
+    {
+        if (now - hs->accept_ms >= HTTP_HEADERS_MS)
+        {
+            return http_deadline_abort(tpcb, METRIC_CNT_DEADLINE_HEADERS);
+        }
+        return ERR_OK;
+    }
+
+    // 3. Body (assembled or streamed to flash): minimum average rate per window
+    if (hs->upload || hs->req != NULL)
+    {
+        u32_t elapsed = now - hs->rate_ms;
+
+        if (elapsed >= HTTP_BODY_WINDOW_MS)
+        {
+            if (hs->rx_bytes - hs->rate_bytes < (u32_t)HTTP_BODY_MIN_BPS * elapsed / 1000U)
+            {
+                return http_deadline_abort(tpcb, METRIC_CNT_DEADLINE_BODY_RATE);
+            }
+            hs->rate_ms = now;
+            hs->rate_bytes = hs->rx_bytes;
+        }
+        return ERR_OK;
+    }
+
+    // A response still draining gets a few more chances before we give up
+    if ((hs->left > 0 || hs->gen != NULL) && hs->retries < HTTP_DRAIN_POLLS)
+    {
+        hs->retries++;
+        http_send_data(tpcb, hs);
+        return ERR_OK;
+    }
+
     http_close(tpcb, hs); // Auto-close idle connections
     return ERR_OK;
 }
@@ -0,0 +1,276 @@
+/* Core/Src/http_sse.c
+ *
+ * Server-Sent Events push channel for the HTTP server.
+ *
+ * Every subscriber keeps its TCP connection open. An event is rendered once
+ * into a PBUF_RAM and handed to each subscriber with tcp_write() *without*
+ * TCP_WRITE_FLAG_COPY, so lwIP only references the payload. Each subscriber
+ * holds its own pbuf_ref() until the bytes are ACKed (tcp_sent), then drops it.
+ */
+
+#include "http_sse.h"
+#include "lwip/pbuf.h"
+#include <string.h>
+
+/* One chunk of written-but-unACKed data. p == NULL means flash-resident data. */
+struct sse_pending {
+    struct pbuf *p;
+    u16_t left;
+};
+
+struct sse_client {
+    struct tcp_pcb *pcb;
+    uint8_t polls;          // Poll ticks since the last keep-alive
+    uint8_t head;           // Oldest pending entry
+    uint8_t count;          // Number of pending entries
+    struct sse_pending q[HTTP_SSE_QUEUE_LEN];
+};
+
+static struct sse_client sse_clients[HTTP_SSE_MAX_CLIENTS];
+
+static const char sse_headers[] =
+"HTTP/1.1 200 OK\r\n"
+"Content-Type: text/event-stream\r\n"
+"Cache-Control: no-cache\r\n"
+"Connection: keep-alive\r\n\r\n"
+"retry: 3000\n\n";
+
+static const char sse_keepalive[] = ": ping\n\n";
+
+/* Forward declarations */
+static err_t sse_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
+static err_t sse_sent(void *arg, struct tcp_pcb *tpcb, u16_t len);
+static err_t sse_poll(void *arg, struct tcp_pcb *tpcb);
+static void sse_conn_err(void *arg, err_t err);
+static err_t sse_queue(struct sse_client *c, struct pbuf *p, const void *data, u16_t len);
+static void sse_release(struct sse_client *c);
+static void sse_drop(struct sse_client *c);
+
+err_t http_sse_subscribe(struct tcp_pcb *tpcb)
+{
+    struct sse_client *c = NULL;
+    uint8_t i;
+
+    for (i = 0; i < HTTP_SSE_MAX_CLIENTS; i++)
+    {
+        if (sse_clients[i].pcb == NULL)
+        {
+            c = &sse_clients[i];
+            break;
+        }
+    }
+    if (c == NULL)
+    {
+        return ERR_MEM;
+    }
+
+    memset(c, 0, sizeof(*c));
+    c->pcb = tpcb;
+
+    tcp_arg(tpcb, c);
+    tcp_recv(tpcb, sse_recv);
+    tcp_sent(tpcb, sse_sent);
+    tcp_err(tpcb, sse_conn_err);
+    tcp_poll(tpcb, sse_poll, 4); // Poll every 2s
+
+    // Headers live in flash, so they can be referenced instead of copied
+    if (sse_queue(c, NULL, sse_headers, sizeof(sse_headers) - 1) != ERR_OK)
+    {
+        c->pcb = NULL;
+        return ERR_MEM;
+    }
+    tcp_output(tpcb);
+
+    return ERR_OK;
+}
+
+void http_sse_publish(const char *event, const char *data)
+{
+    struct pbuf *p;
+    char *out;
+    u16_t ev_len, data_len, len;
+    uint8_t i, active = 0;
+
+    for (i = 0; i < HTTP_SSE_MAX_CLIENTS; i++)
+    {
+        if (sse_clients[i].pcb != NULL) active++;
+    }
+    if (active == 0)
+    {
+        return; // Nobody listening, don't even render
+    }
+
+    // "event: <event>\ndata: <data>\n\n"
+    ev_len = (u16_t)strlen(event);
+    data_len = (u16_t)strlen(data);
+    len = 7 + ev_len + 7 + data_len + 2;
+
+    // 1. Render the event ONCE
+    p = pbuf_alloc(PBUF_RAW, len, PBUF_RAM);
+    if (p == NULL)
+    {
+        return;
+    }
+    out = (char *)p->payload;
+    memcpy(out, "event: ", 7);           out += 7;
+    memcpy(out, event, ev_len);          out += ev_len;
+    memcpy(out, "\ndata: ", 7);          out += 7;
+    memcpy(out, data, data_len);         out += data_len;
+    memcpy(out, "\n\n", 2);
+
+    // 2. Fan out: every subscriber references the same payload
+    for (i = 0; i < HTTP_SSE_MAX_CLIENTS; i++)
+    {
+        struct sse_client *c = &sse_clients[i];
+        if (c->pcb == NULL) continue;
+
+        // A slow client just misses this event; the next one carries the new state
+        if (sse_queue(c, p, p->payload, len) == ERR_OK)
+        {
+            tcp_output(c->pcb);
+        }
+    }
+
+    // 3. Drop our own reference; subscribers keep theirs until ACKed
+    pbuf_free(p);
+}
+
+/* Write data without copying and remember it until the peer ACKs it */
+static err_t sse_queue(struct sse_client *c, struct pbuf *p, const void *data, u16_t len)
+{
+    struct sse_pending *e;
+    err_t err;
+
+    if (c->count >= HTTP_SSE_QUEUE_LEN || tcp_sndbuf(c->pcb) < len)
+    {
+        return ERR_MEM;
+    }
+
+    err = tcp_write(c->pcb, data, len, 0);
+    if (err != ERR_OK)
+    {
+        return err;
+    }
+
+    e = &c->q[(c->head + c->count) % HTTP_SSE_QUEUE_LEN];
+    e->p = p;
+    e->left = len;
+    c->count++;
+
+    if (p != NULL)
+    {
+        pbuf_ref(p);
+    }
+    return ERR_OK;
+}
+
+static err_t sse_sent(void *arg, struct tcp_pcb *tpcb, u16_t len)
+{
+    struct sse_client *c = (struct sse_client *)arg;
+    LWIP_UNUSED_ARG(tpcb);
+
+    while (len > 0 && c->count > 0)
+    {
+        struct sse_pending *e = &c->q[c->head];
+        u16_t n = (len < e->left) ? len : e->left;
+
+        e->left -= n;
+        len -= n;
+
+        if (e->left == 0)
+        {
+            if (e->p != NULL) pbuf_free(e->p);
+            e->p = NULL;
+            c->head = (c->head + 1) % HTTP_SSE_QUEUE_LEN;
+            c->count--;
+        }
+    }
+    return ERR_OK;
+}
+
+static err_t sse_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err)
+{
+    struct sse_client *c = (struct sse_client *)arg;
+
+    if (p == NULL || err != ERR_OK)
+    {
+        // Client went away. Abort so unACKed events can be released right now.
+        if (p != NULL) pbuf_free(p);
+        sse_drop(c);
+        return ERR_ABRT;
+    }
+
+    // Nothing is expected upstream on an event stream: just open the window
+    tcp_recved(tpcb, p->tot_len);
+    pbuf_free(p);
+    return ERR_OK;
+}
+
+static err_t sse_poll(void *arg, struct tcp_pcb *tpcb)
+{
+    struct sse_client *c = (struct sse_client *)arg;
+
+    if (c == NULL)
+    {
+        tcp_abort(tpcb);
+        return ERR_ABRT;
+    }
+
+    if (++c->polls >= HTTP_SSE_KEEPALIVE_POLLS)
+    {
+        // A stuck queue at keep-alive time means the client stopped ACKing
+        if (c->count >= HTTP_SSE_QUEUE_LEN)
+        {
+            sse_drop(c);
+            return ERR_ABRT;
+        }
+
+        c->polls = 0;
+        if (sse_queue(c, NULL, sse_keepalive, sizeof(sse_keepalive) - 1) == ERR_OK)
+        {
+            tcp_output(tpcb);
+        }
+    }
+    return ERR_OK;
+}
+
+static void sse_conn_err(void *arg, err_t err)
+{
+    struct sse_client *c = (struct sse_client *)arg;
+    LWIP_UNUSED_ARG(err);
+
+    // PCB is already freed by lwIP
+    if (c != NULL)
+    {
+        sse_release(c);
+    }
+}
+
+/* Return every queued pbuf reference and free the slot */
+static void sse_release(struct sse_client *c)
+{
+    while (c->count > 0)
+    {
+        struct sse_pending *e = &c->q[c->head];
+        if (e->p != NULL) pbuf_free(e->p);
+        e->p = NULL;
+        c->head = (c->head + 1) % HTTP_SSE_QUEUE_LEN;
+        c->count--;
+    }
+    c->pcb = NULL;
+}
+
+static void sse_drop(struct sse_client *c)
+{
+    struct tcp_pcb *tpcb = c->pcb;
+
+    tcp_arg(tpcb, NULL);
+    tcp_sent(tpcb, NULL);
+    tcp_recv(tpcb, NULL);
+    tcp_err(tpcb, NULL);
+    tcp_poll(tpcb, NULL, 0);
+
+    // RST frees the pcb (and its references to our payloads) immediately
+    tcp_abort(tpcb);
+    sse_release(c);
+}
@@ -0,0 +1,88 @@
+/* Core/Src/http_tmpl.c
+ *
+ * Server-side includes for flash-resident pages.
+ *
+ * Templates are sent straight from flash: literal text between markers is
+ * queued by reference and only a <!--#tag--> is rendered (by its handler)
+ * into a small stack buffer and copied. A dynamic page therefore costs a few
+ * dozen bytes of RAM at a time, however large it is.
+ */
+
+#include "http_tmpl.h"
+#include <string.h>
+
+#define TMPL_OPEN       "<!--#"
+#define TMPL_OPEN_LEN   5
+#define TMPL_CLOSE      "-->"
+#define TMPL_CLOSE_LEN  3
+
+struct tmpl_tag {
+    const char *name;
+    http_tmpl_fn fn;
+};
+
+static struct tmpl_tag tmpl_tags[HTTP_TMPL_MAX_TAGS];
+
+err_t http_tmpl_register(const char *tag, http_tmpl_fn fn)
+{
+    uint8_t i;
+
+    for (i = 0; i < HTTP_TMPL_MAX_TAGS; i++)
+    {
+        if (tmpl_tags[i].name == NULL || strcmp(tmpl_tags[i].name, tag) == 0)
+        {
+            tmpl_tags[i].name = tag;
+            tmpl_tags[i].fn = fn;
+            return ERR_OK;
+        }
+    }
+    return ERR_MEM;
+}
+
+u16_t http_tmpl_literal(const char *s, u16_t len)
+{
+    u16_t i;
+
+    for (i = 0; i + TMPL_OPEN_LEN <= len; i++)
+    {
+        if (s[i] == '<' && memcmp(&s[i], TMPL_OPEN, TMPL_OPEN_LEN) == 0)
+        {
+            return i;
+        }
+    }
+    return len;
+}
+
+u16_t http_tmpl_render(const char *s, u16_t len, char *buf, u16_t size, u16_t *consumed)
+{
+    const char *name = s + TMPL_OPEN_LEN;
+    u16_t nlen;
+    uint8_t i;
+
+    // 1. Find the end of the tag name
+    for (nlen = 0; nlen <= HTTP_TMPL_TAG_MAX && TMPL_OPEN_LEN + nlen + TMPL_CLOSE_LEN <= len; nlen++)
+    {
+        if (memcmp(&name[nlen], TMPL_CLOSE, TMPL_CLOSE_LEN) == 0)
+        {
+            break;
+        }
+    }
+    if (nlen > HTTP_TMPL_TAG_MAX || TMPL_OPEN_LEN + nlen + TMPL_CLOSE_LEN > len)
+    {
+        // Not a tag after all: emit the opening as plain text
+        *consumed = TMPL_OPEN_LEN;
+        memcpy(buf, TMPL_OPEN, TMPL_OPEN_LEN);
+        return TMPL_OPEN_LEN;
+    }
+    *consumed = (u16_t)(TMPL_OPEN_LEN + nlen + TMPL_CLOSE_LEN);
+
+    // 2. Run its handler
+    for (i = 0; i < HTTP_TMPL_MAX_TAGS && tmpl_tags[i].name != NULL; i++)
+    {
+        if (strlen(tmpl_tags[i].name) == nlen && memcmp(tmpl_tags[i].name, name, nlen) == 0)
+        {
+            return tmpl_tags[i].fn(buf, size);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,629 @@
+/* Core/Src/http_ws.c
+ *
+ * RFC 6455 WebSocket command channel on the HTTP listener.
+ *
+ * Client frames are parsed byte-wise straight out of the received pbuf chain,
+ * so a frame may be split across any number of segments. Data messages may be
+ * fragmented (continuation frames) and control frames may arrive in between.
+ * Each complete text/binary message is treated as one JSON command, the same
+ * format as POST /api/cmd, and answered with a single text frame.
+ */
+
+#include "http_ws.h"
+#include "cmd_exec.h"
+#include <string.h>
+#include <strings.h>
+
+/* Opcodes */
+#define WS_OP_CONT      0x0
+#define WS_OP_TEXT      0x1
+#define WS_OP_BINARY    0x2
+#define WS_OP_CLOSE     0x8
+#define WS_OP_PING      0x9
+#define WS_OP_PONG      0xA
+
+/* Close status codes */
+#define WS_CLOSE_PROTOCOL   1002
+#define WS_CLOSE_TOO_BIG    1009
+
+#define WS_MAX_CTRL     125
+
+/* Receive state */
+enum ws_rx_states
+{
+    WS_RX_HEADER = 0,
+    WS_RX_PAYLOAD
+};
+
+struct ws_client {
+    struct tcp_pcb *pcb;
+    uint8_t rx_state;
+    uint8_t hdr[14];        // Frame header being collected
+    uint8_t hdr_len;
+    uint8_t hdr_need;
+    uint8_t opcode;         // Opcode of the frame being received
+    uint8_t fin;
+    uint8_t msg_op;         // Opcode of the data message in progress (0 = none)
+    uint8_t polls;          // Idle poll ticks
+    uint8_t ping_out;       // We pinged and are waiting for the pong
+    uint8_t mask[4];
+    uint32_t remaining;     // Payload bytes of this frame still to come
+    uint8_t mask_pos;
+    uint8_t ctl_len;
+    uint16_t msg_len;
+    uint8_t ctl[WS_MAX_CTRL];
+    uint8_t msg[HTTP_WS_MAX_MSG];
+};
+
+static struct ws_client ws_clients[HTTP_WS_MAX_CLIENTS];
+
+static const char ws_guid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+/* Forward declarations */
+static err_t ws_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
+static err_t ws_poll(void *arg, struct tcp_pcb *tpcb);
+static void ws_conn_err(void *arg, err_t err);
+static err_t ws_input(struct ws_client *c, const uint8_t *data, u16_t len);
+static err_t ws_header_done(struct ws_client *c);
+static err_t ws_frame_done(struct ws_client *c);
+static err_t ws_send_frame(struct ws_client *c, uint8_t opcode, const void *payload, u16_t len);
+static err_t ws_fail(struct ws_client *c, uint16_t code);
+static err_t ws_close(struct ws_client *c);
+static const char *ws_header(const char *req, u16_t len, const char *name, u16_t *val_len);
+static void ws_sha1(const uint8_t *msg, u16_t len, uint8_t digest[20]);
+static void ws_base64(const uint8_t *in, u16_t len, char *out);
+
+err_t http_ws_upgrade(struct tcp_pcb *tpcb, const char *req, u16_t len)
+{
+    static const char resp_head[] =
+        "HTTP/1.1 101 Switching Protocols\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Accept: ";
+    struct ws_client *c = NULL;
+    uint8_t concat[64];
+    uint8_t digest[20];
+    char accept[32];
+    const char *key, *upgrade, *version;
+    u16_t key_len, upgrade_len, version_len;
+    u16_t i;
+
+    // 1. A version 13 websocket upgrade, and the client's key
+    upgrade = ws_header(req, len, "Upgrade:", &upgrade_len);
+    version = ws_header(req, len, "Sec-WebSocket-Version:", &version_len);
+    key = ws_header(req, len, "Sec-WebSocket-Key:", &key_len);
+    if (upgrade == NULL || upgrade_len != 9 || strncasecmp(upgrade, "websocket", 9) != 0 ||
+        version == NULL || version_len != 2 || memcmp(version, "13", 2) != 0)
+    {
+        return ERR_VAL;
+    }
+    if (key == NULL || key_len == 0 || key_len + sizeof(ws_guid) - 1 > sizeof(concat))
+    {
+        return ERR_VAL;
+    }
+
+    // 2. Grab a slot
+    for (i = 0; i < HTTP_WS_MAX_CLIENTS; i++)
+    {
+        if (ws_clients[i].pcb == NULL)
+        {
+            c = &ws_clients[i];
+            break;
+        }
+    }
+    if (c == NULL)
+    {
+        return ERR_MEM;
+    }
+
+    // 3. Sec-WebSocket-Accept = base64(SHA-1(key + GUID))
+    memcpy(concat, key, key_len);
+    memcpy(concat + key_len, ws_guid, sizeof(ws_guid) - 1);
+    ws_sha1(concat, key_len + sizeof(ws_guid) - 1, digest);
+    ws_base64(digest, sizeof(digest), accept);
+
+    if (tcp_write(tpcb, resp_head, sizeof(resp_head) - 1, TCP_WRITE_FLAG_MORE) != ERR_OK ||
+        tcp_write(tpcb, accept, strlen(accept), TCP_WRITE_FLAG_COPY | TCP_WRITE_FLAG_MORE) != ERR_OK ||
+        tcp_write(tpcb, "\r\n\r\n", 4, 0) != ERR_OK)
+    {
+        return ERR_MEM;
+    }
+
+    memset(c, 0, sizeof(*c));
+    c->pcb = tpcb;
+    c->hdr_need = 2;
+
+    tcp_arg(tpcb, c);
+    tcp_recv(tpcb, ws_recv);
+    tcp_sent(tpcb, NULL);
+    tcp_err(tpcb, ws_conn_err);
+    tcp_poll(tpcb, ws_poll, 4); // Poll every 2s
+
+    // Small frames: don't let Nagle hold acknowledgements back
+    tcp_nagle_disable(tpcb);
+    tcp_output(tpcb);
+
+    return ERR_OK;
+}
+
+static err_t ws_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err)
+{
+    struct ws_client *c = (struct ws_client *)arg;
+    struct pbuf *q;
+    err_t ret = ERR_OK;
+
+    if (p == NULL)
+    {
+        // Connection closed by client
+        return (ws_close(c) == ERR_ABRT) ? ERR_ABRT : ERR_OK;
+    }
+    else if (err != ERR_OK)
+    {
+        pbuf_free(p);
+        return err;
+    }
+
+    c->polls = 0;
+
+    for (q = p; q != NULL && ret == ERR_OK; q = q->next)
+    {
+        ret = ws_input(c, (const uint8_t *)q->payload, q->len);
+    }
+
+    // Acknowledge first: closing with unread data would send a RST instead of FIN
+    tcp_recved(tpcb, p->tot_len);
+    pbuf_free(p);
+
+    // ERR_CLSD: the parser sent a close frame, the rest of the segment is ignored
+    if (ret == ERR_CLSD)
+    {
+        return (ws_close(c) == ERR_ABRT) ? ERR_ABRT : ERR_OK;
+    }
+    return ERR_OK;
+}
+
+/* Feed received bytes into the frame parser */
+static err_t ws_input(struct ws_client *c, const uint8_t *data, u16_t len)
+{
+    err_t ret;
+
+    while (len > 0)
+    {
+        if (c->rx_state == WS_RX_HEADER)
+        {
+            c->hdr[c->hdr_len++] = *data++;
+            len--;
+
+            if (c->hdr_len == 2)
+            {
+                uint8_t plen = c->hdr[1] & 0x7F;
+
+                // Clients MUST mask every frame
+                if ((c->hdr[1] & 0x80) == 0)
+                {
+                    return ws_fail(c, WS_CLOSE_PROTOCOL);
+                }
+                c->hdr_need = 2 + 4 + ((plen == 126) ? 2 : (plen == 127) ? 8 : 0);
+            }
+
+            if (c->hdr_len == c->hdr_need)
+            {
+                ret = ws_header_done(c);
+                if (ret != ERR_OK) return ret;
+            }
+        }
+        else
+        {
+            // Unmask straight into the message or control buffer
+            uint8_t *dst = (c->opcode & 0x8) ? &c->ctl[c->ctl_len] : &c->msg[c->msg_len];
+            u16_t n = (len < c->remaining) ? len : (u16_t)c->remaining;
+            u16_t i;
+
+            for (i = 0; i < n; i++)
+            {
+                dst[i] = data[i] ^ c->mask[c->mask_pos];
+                c->mask_pos = (c->mask_pos + 1) & 3;
+            }
+            if (c->opcode & 0x8) c->ctl_len += n;
+            else c->msg_len += n;
+
+            data += n;
+            len -= n;
+            c->remaining -= n;
+
+            if (c->remaining == 0)
+            {
+                ret = ws_frame_done(c);
+                if (ret != ERR_OK) return ret;
+            }
+        }
+    }
+    return ERR_OK;
+}
+
+/* Validate a complete frame header and set up payload reception */
+static err_t ws_header_done(struct ws_client *c)
+{
+    uint8_t plen = c->hdr[1] & 0x7F;
+    uint8_t *m;
+    uint32_t length;
+
+    c->fin = c->hdr[0] & 0x80;
+    c->opcode = c->hdr[0] & 0x0F;
+
+    // No extensions negotiated: RSV bits must be zero
+    if (c->hdr[0] & 0x70)
+    {
+        return ws_fail(c, WS_CLOSE_PROTOCOL);
+    }
+
+    if (plen == 126)
+    {
+        length = ((uint32_t)c->hdr[2] << 8) | c->hdr[3];
+        m = &c->hdr[4];
+    }
+    else if (plen == 127)
+    {
+        // Anything beyond 32 bits is far beyond what we accept anyway
+        if (c->hdr[2] | c->hdr[3] | c->hdr[4] | c->hdr[5])
+        {
+            return ws_fail(c, WS_CLOSE_TOO_BIG);
+        }
+        length = ((uint32_t)c->hdr[6] << 24) | ((uint32_t)c->hdr[7] << 16) |
+                 ((uint32_t)c->hdr[8] << 8) | c->hdr[9];
+        m = &c->hdr[10];
+    }
+    else
+    {
+        length = plen;
+        m = &c->hdr[2];
+    }
+    memcpy(c->mask, m, 4);
+
+    if (c->opcode & 0x8)
+    {
+        // Control frame: never fragmented, at most 125 bytes
+        if (!c->fin || length > WS_MAX_CTRL ||
+            (c->opcode != WS_OP_CLOSE && c->opcode != WS_OP_PING && c->opcode != WS_OP_PONG))
+        {
+            return ws_fail(c, WS_CLOSE_PROTOCOL);
+        }
+        c->ctl_len = 0;
+    }
+    else
+    {
+        if (c->opcode == WS_OP_CONT)
+        {
+            if (c->msg_op == 0) return ws_fail(c, WS_CLOSE_PROTOCOL);
+        }
+        else if (c->opcode == WS_OP_TEXT || c->opcode == WS_OP_BINARY)
+        {
+            if (c->msg_op != 0) return ws_fail(c, WS_CLOSE_PROTOCOL);
+            c->msg_op = c->opcode;
+            c->msg_len = 0;
+        }
+        else
+        {
+            return ws_fail(c, WS_CLOSE_PROTOCOL);
+        }
+
+        if (length > (uint32_t)(HTTP_WS_MAX_MSG - c->msg_len))
+        {
+            return ws_fail(c, WS_CLOSE_TOO_BIG);
+        }
+    }
+
+    c->remaining = length;
+    c->mask_pos = 0;
+    c->hdr_len = 0;
+    c->hdr_need = 2;
+    c->rx_state = WS_RX_PAYLOAD;
+
+    // Empty payload: the frame is already complete
+    if (length == 0)
+    {
+        return ws_frame_done(c);
+    }
+    return ERR_OK;
+}
+
+/* A whole frame has been received */
+static err_t ws_frame_done(struct ws_client *c)
+{
+    c->rx_state = WS_RX_HEADER;
+
+    switch (c->opcode)
+    {
+    case WS_OP_PING:
+        ws_send_frame(c, WS_OP_PONG, c->ctl, c->ctl_len);
+        return ERR_OK;
+
+    case WS_OP_PONG:
+        c->ping_out = 0;
+        return ERR_OK;
+
+    case WS_OP_CLOSE:
+        // Echo the status code back, then we are done
+        ws_send_frame(c, WS_OP_CLOSE, c->ctl, (c->ctl_len >= 2) ? 2 : 0);
+        return ERR_CLSD;
+
+    default:
+        break;
+    }
+
+    if (!c->fin)
+    {
+        return ERR_OK; // Wait for the continuation frames
+    }
+
+    // Complete message: one command in, one acknowledgement out
+    {
+        static const char nack[] = "{\"status\":\"error\"}";
+        char ack[48];
+        cmd_action_t action = cmd_parse((const char *)c->msg, c->msg_len);
+
+        c->msg_op = 0;
+        c->msg_len = 0;
+
+        if (action == CMD_NONE)
+        {
+            ws_send_frame(c, WS_OP_TEXT, nack, sizeof(nack) - 1);
+            return ERR_OK;
+        }
+
+        cmd_execute(action);
+
+        // {"status":"ok","led":"ON"}
+        strcpy(ack, "{\"status\":\"ok\",");
+        strcat(ack, cmd_led_json() + 1);
+        ws_send_frame(c, WS_OP_TEXT, ack, strlen(ack));
+        return ERR_OK;
+    }
+}
+
+/* Server frames are never masked */
+static err_t ws_send_frame(struct ws_client *c, uint8_t opcode, const void *payload, u16_t len)
+{
+    uint8_t hdr[4];
+    u16_t hdr_len = 2;
+    err_t err;
+
+    hdr[0] = 0x80 | opcode;
+    if (len < 126)
+    {
+        hdr[1] = (uint8_t)len;
+    }
+    else
+    {
+        hdr[1] = 126;
+        hdr[2] = (uint8_t)(len >> 8);
+        hdr[3] = (uint8_t)len;
+        hdr_len = 4;
+    }
+
+    if (tcp_sndbuf(c->pcb) < hdr_len + len)
+    {
+        return ERR_MEM;
+    }
+
+    err = tcp_write(c->pcb, hdr, hdr_len, TCP_WRITE_FLAG_COPY | (len ? TCP_WRITE_FLAG_MORE : 0));
+    if (err == ERR_OK && len > 0)
+    {
+        err = tcp_write(c->pcb, payload, len, TCP_WRITE_FLAG_COPY);
+    }
+    if (err == ERR_OK)
+    {
+        tcp_output(c->pcb);
+    }
+    return err;
+}
+
+/* Protocol error: send a close frame with the reason; ERR_CLSD makes ws_recv drop the connection */
+static err_t ws_fail(struct ws_client *c, uint16_t code)
+{
+    uint8_t status[2];
+
+    status[0] = (uint8_t)(code >> 8);
+    status[1] = (uint8_t)code;
+    ws_send_frame(c, WS_OP_CLOSE, status, 2);
+    return ERR_CLSD;
+}
+
+static err_t ws_poll(void *arg, struct tcp_pcb *tpcb)
+{
+    struct ws_client *c = (struct ws_client *)arg;
+
+    if (c == NULL)
+    {
+        tcp_abort(tpcb);
+        return ERR_ABRT;
+    }
+
+    if (++c->polls >= HTTP_WS_PING_POLLS)
+    {
+        // Still no pong from the last ping: the peer is gone
+        if (c->ping_out)
+        {
+            return (ws_close(c) == ERR_ABRT) ? ERR_ABRT : ERR_OK;
+        }
+
+        c->polls = 0;
+        if (ws_send_frame(c, WS_OP_PING, NULL, 0) == ERR_OK)
+        {
+            c->ping_out = 1;
+        }
+    }
+    return ERR_OK;
+}
+
+static void ws_conn_err(void *arg, err_t err)
+{
+    struct ws_client *c = (struct ws_client *)arg;
+    LWIP_UNUSED_ARG(err);
+
+    // PCB is already freed by lwIP
+    if (c != NULL)
+    {
+        c->pcb = NULL;
+    }
+}
+
+/* Returns ERR_CLSD, or ERR_ABRT when the pcb had to be aborted */
+static err_t ws_close(struct ws_client *c)
+{
+    struct tcp_pcb *tpcb = c->pcb;
+
+    tcp_arg(tpcb, NULL);
+    tcp_sent(tpcb, NULL);
+    tcp_recv(tpcb, NULL);
+    tcp_err(tpcb, NULL);
+    tcp_poll(tpcb, NULL, 0);
+
+    c->pcb = NULL;
+
+    if (tcp_close(tpcb) != ERR_OK)
+    {
+        tcp_abort(tpcb);
+        return ERR_ABRT;
+    }
+    return ERR_CLSD;
+}
+
+/* Value of a request header (name given with its ':', any case) and its length, or NULL */
+static const char *ws_header(const char *req, u16_t len, const char *name, u16_t *val_len)
+{
+    u16_t nlen = (u16_t)strlen(name);
+    u16_t i, start;
+
+    for (i = 0; i + nlen < len; i++)
+    {
+        if (i > 0 && req[i - 1] != '\n') continue;
+        if (req[i] == '\r') break; // Empty line: end of headers
+
+        if (strncasecmp(&req[i], name, nlen) == 0)
+        {
+            i += nlen;
+            while (i < len && req[i] == ' ') i++;
+            start = i;
+            while (i < len && req[i] != '\r' && req[i] != '\n') i++;
+            while (i > start && req[i - 1] == ' ') i--;
+            *val_len = (u16_t)(i - start);
+            return &req[start];
+        }
+    }
+    return NULL;
+}
+
+/* --- SHA-1 (handshake only, so size beats speed) --- */
+
+#define WS_ROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+static void ws_sha1_block(uint32_t h[5], const uint8_t *blk)
+{
+    uint32_t w[16];
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    uint32_t f, k, t;
+    int i;
+
+    for (i = 0; i < 16; i++)
+    {
+        w[i] = ((uint32_t)blk[4 * i] << 24) | ((uint32_t)blk[4 * i + 1] << 16) |
+               ((uint32_t)blk[4 * i + 2] << 8) | blk[4 * i + 3];
+    }
+
+    for (i = 0; i < 80; i++)
+    {
+        if (i >= 16)
+        {
+            t = w[(i + 13) & 15] ^ w[(i + 8) & 15] ^ w[(i + 2) & 15] ^ w[i & 15];
+            w[i & 15] = WS_ROL(t, 1);
+        }
+
+        if (i < 20)      { f = (b & c) | (~b & d);          k = 0x5A827999; }
+        else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+        else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+        else             { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+
+        t = WS_ROL(a, 5) + f + e + k + w[i & 15];
+        e = d;
+        d = c;
+        c = WS_ROL(b, 30);
+        b = a;
+        a = t;
+    }
+
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+}
+
+static void ws_sha1(const uint8_t *msg, u16_t len, uint8_t digest[20])
+{
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    uint8_t blk[64];
+    uint32_t bits = (uint32_t)len * 8;
+    u16_t done = 0;
+    u16_t n;
+    int i;
+
+    while (len - done >= 64)
+    {
+        ws_sha1_block(h, msg + done);
+        done += 64;
+    }
+
+    // Padding: 0x80, zeros, 64-bit big-endian bit length
+    n = len - done;
+    memset(blk, 0, sizeof(blk));
+    memcpy(blk, msg + done, n);
+    blk[n] = 0x80;
+    if (n >= 56)
+    {
+        ws_sha1_block(h, blk);
+        memset(blk, 0, sizeof(blk));
+    }
+    blk[60] = (uint8_t)(bits >> 24);
+    blk[61] = (uint8_t)(bits >> 16);
+    blk[62] = (uint8_t)(bits >> 8);
+    blk[63] = (uint8_t)bits;
+    ws_sha1_block(h, blk);
+
+    for (i = 0; i < 5; i++)
+    {
+        digest[4 * i]     = (uint8_t)(h[i] >> 24);
+        digest[4 * i + 1] = (uint8_t)(h[i] >> 16);
+        digest[4 * i + 2] = (uint8_t)(h[i] >> 8);
+        digest[4 * i + 3] = (uint8_t)h[i];
+    }
+}
+
+static void ws_base64(const uint8_t *in, u16_t len, char *out)
+{
+    static const char tbl[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    u16_t i;
+
+    for (i = 0; i + 2 < len; i += 3)
+    {
+        *out++ = tbl[in[i] >> 2];
+        *out++ = tbl[((in[i] & 0x03) << 4) | (in[i + 1] >> 4)];
+        *out++ = tbl[((in[i + 1] & 0x0F) << 2) | (in[i + 2] >> 6)];
+        *out++ = tbl[in[i + 2] & 0x3F];
+    }
+    if (len - i == 1)
+    {
+        *out++ = tbl[in[i] >> 2];
+        *out++ = tbl[(in[i] & 0x03) << 4];
+        *out++ = '=';
+        *out++ = '=';
+    }
+    else if (len - i == 2)
+    {
+        *out++ = tbl[in[i] >> 2];
+        *out++ = tbl[((in[i] & 0x03) << 4) | (in[i + 1] >> 4)];
+        *out++ = tbl[(in[i + 1] & 0x0F) << 2];
+        *out++ = '=';
+    }
+    *out = '\0';
+}
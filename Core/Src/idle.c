@@ -0,0 +1,125 @@
+/* Core/Src/idle.c
+ *
+ * Tickless idle for the main loop.
+ *
+ * Between two lwIP timeouts the loop only has work when a frame or a console
+ * key comes in. idle_sleep() therefore stops SysTick and waits in WFI for the
+ * first of: TIM2 compare 1 at the next timeout (TIM2 is the 1 us counter
+ * metrics already runs), the USART2 receive interrupt, or the ENC28J60 INT
+ * line. Without that line the sleep is cut into IDLE_POLL_US slices, each
+ * ending with a read of the receive packet count.
+ *
+ * On the way out the milliseconds SysTick missed are added to uwTick,
+ * counted from its phase when it was stopped, so HAL_GetTick() (and with it
+ * sys_now()) does not drift however often the CPU sleeps.
+ */
+
+#include "idle.h"
+#include "metrics.h"
+#include "lwip/timeouts.h"
+#include "ethernetif.h"
+#include "enc28j60.h"
+
+extern ENC_HandleTypeDef henc;
+
+static uint8_t idle_frame_pending(void)
+{
+    // Frames the self-test held back are waiting for the main loop too
+    if (ethernetif_held_pending()) return 1;
+#if IDLE_ENC_INT
+    // PKTIE keeps INT asserted while EPKTCNT is not 0
+    return HAL_GPIO_ReadPin(IDLE_ENC_INT_GPIO_Port, IDLE_ENC_INT_Pin) == GPIO_PIN_RESET;
+#else
+    return enc_packet_receive_status(&henc) != 0;
+#endif
+}
+
+static uint8_t idle_key_pending(void)
+{
+    return (USART2->ISR & (USART_ISR_RXNE_RXFNE | USART_ISR_ORE)) != 0;
+}
+
+void idle_init(void)
+{
+    TIM2->DIER &= ~TIM_DIER_CC1IE;
+    HAL_NVIC_SetPriority(TIM2_IRQn, 3, 0);
+    HAL_NVIC_EnableIRQ(TIM2_IRQn);
+
+    // RXNEIE is only set while asleep; console_poll() keeps reading RDR itself
+    HAL_NVIC_SetPriority(USART2_IRQn, 3, 0);
+    HAL_NVIC_EnableIRQ(USART2_IRQn);
+
+#if IDLE_ENC_INT
+    GPIO_InitTypeDef gpio = {0};
+
+    gpio.Pin = IDLE_ENC_INT_Pin;
+    gpio.Mode = GPIO_MODE_IT_FALLING;
+    gpio.Pull = GPIO_PULLUP;
+    HAL_GPIO_Init(IDLE_ENC_INT_GPIO_Port, &gpio);
+    HAL_NVIC_SetPriority(EXTI4_15_IRQn, 3, 0);
+    HAL_NVIC_EnableIRQ(EXTI4_15_IRQn);
+#endif
+}
+
+void idle_sleep(void)
+{
+    u32_t ms = sys_timeouts_sleeptime();
+    uint32_t t0, phase_us, end;
+
+    if (ms < IDLE_MIN_SLEEP_MS) return;
+    if (ms > IDLE_MAX_SLEEP_MS) ms = IDLE_MAX_SLEEP_MS;
+    if (idle_key_pending() || idle_frame_pending()) return;
+
+    // 1. Stop the tick, noting how far into the current millisecond it was
+    HAL_SuspendTick();
+    __disable_irq();
+    t0 = metrics_now_us();
+    phase_us = (SysTick->LOAD - SysTick->VAL) * 1000U / (SysTick->LOAD + 1U);
+    __enable_irq();
+    end = t0 + ms * 1000U;
+
+    // 2. Sleep up to the deadline, a slice at a time when the ENC28J60 is polled
+    USART2->CR1 |= USART_CR1_RXNEIE_RXFNEIE;
+    for (;;)
+    {
+        uint32_t now = metrics_now_us();
+        int32_t left = (int32_t)(end - now);
+
+        if (left <= 0) break;
+        if (!IDLE_ENC_INT && left > (int32_t)IDLE_POLL_US) left = IDLE_POLL_US;
+
+        TIM2->CCR1 = now + (uint32_t)left;
+        TIM2->SR = ~TIM_SR_CC1IF;
+        TIM2->DIER |= TIM_DIER_CC1IE;
+
+        // A wake-up that comes after the check stays pending and ends the WFI
+        __disable_irq();
+        if ((int32_t)(TIM2->CCR1 - metrics_now_us()) > 0)
+        {
+            __WFI();
+        }
+        __enable_irq();
+
+        TIM2->DIER &= ~TIM_DIER_CC1IE;
+        if (idle_key_pending() || idle_frame_pending()) break;
+    }
+    USART2->CR1 &= ~USART_CR1_RXNEIE_RXFNEIE;
+
+    // 3. Hand HAL_GetTick() the milliseconds SysTick did not count
+    __disable_irq();
+    uwTick += (phase_us + (metrics_now_us() - t0)) / 1000U;
+    __enable_irq();
+    HAL_ResumeTick();
+}
+
+void idle_tim_irq(void)
+{
+    TIM2->SR = ~TIM_SR_CC1IF;
+    TIM2->DIER &= ~TIM_DIER_CC1IE;
+}
+
+void idle_uart_irq(void)
+{
+    // Leave the byte (or the overrun) to console_poll()
+    USART2->CR1 &= ~USART_CR1_RXNEIE_RXFNEIE;
+}
@@ -0,0 +1,95 @@
+/* Core/Src/iperf_server.c
+ *
+ * iperf2 server (lwIP's lwiperf app) with its results on the UART.
+ *
+ * lwiperf receives into the normal TCP receive path and transmits straight
+ * from a flash buffer (no copy), so the figures are those of the stack and
+ * the ENC28J60 link, not of the application. The report arrives once per
+ * session; it is printed and kept for the console ('i').
+ */
+
+#include "iperf_server.h"
+#include "main.h"
+#include "lwip/apps/lwiperf.h"
+#include <stdio.h>
+#include <string.h>
+
+extern UART_HandleTypeDef huart2;
+
+static const char *const iperf_result_names[] = {
+    "server", "client", "aborted_local", "data_error", "tx_error", "aborted_remote",
+};
+
+static struct {
+    uint8_t valid;
+    uint8_t type;
+    u16_t remote_port;
+    ip_addr_t remote;
+    u32_t bytes;
+    u32_t ms;
+    u32_t kbps;
+} iperf_last;
+
+static void iperf_report(void *arg, enum lwiperf_report_type report_type,
+                         const ip_addr_t *local_addr, u16_t local_port,
+                         const ip_addr_t *remote_addr, u16_t remote_port,
+                         u32_t bytes_transferred, u32_t ms_duration, u32_t bandwidth_kbitpsec)
+{
+    char line[96];
+    int n;
+
+    LWIP_UNUSED_ARG(arg);
+    LWIP_UNUSED_ARG(local_addr);
+    LWIP_UNUSED_ARG(local_port);
+
+    iperf_last.valid = 1;
+    iperf_last.type = (uint8_t)report_type;
+    // An aborted session may no longer know its peer
+    if (remote_addr != NULL)
+    {
+        ip_addr_copy(iperf_last.remote, *remote_addr);
+    }
+    else
+    {
+        ip_addr_set_zero(&iperf_last.remote);
+    }
+    iperf_last.remote_port = remote_port;
+    iperf_last.bytes = bytes_transferred;
+    iperf_last.ms = ms_duration;
+    iperf_last.kbps = bandwidth_kbitpsec;
+
+    n = snprintf(line, sizeof(line), "iperf %s %s:%u: %lu bytes in %lu ms = %lu kbit/s\r\n",
+                 iperf_result_names[iperf_last.type], ipaddr_ntoa(&iperf_last.remote),
+                 (unsigned)remote_port, (unsigned long)bytes_transferred,
+                 (unsigned long)ms_duration, (unsigned long)bandwidth_kbitpsec);
+    HAL_UART_Transmit(&huart2, (uint8_t *)line, (uint16_t)n, 100);
+}
+
+int iperf_server_init(void)
+{
+    return (lwiperf_start_tcp_server_default(iperf_report, NULL) != NULL) ? 0 : -1;
+}
+
+u16_t iperf_server_render(uint16_t *cursor, char *buf, u16_t size)
+{
+    int n;
+
+    if ((*cursor)++ != 0)
+    {
+        return 0;
+    }
+    if (!iperf_last.valid)
+    {
+        n = snprintf(buf, size, "{\"result\":\"none\"}");
+    }
+    else
+    {
+        n = snprintf(buf, size, "{\"result\":\"%s\",\"remote\":\"%s:%u\",\"bytes\":%lu,\"ms\":%lu,\"kbps\":%lu}",
+                     iperf_result_names[iperf_last.type], ipaddr_ntoa(&iperf_last.remote),
+                     (unsigned)iperf_last.remote_port, (unsigned long)iperf_last.bytes,
+                     (unsigned long)iperf_last.ms, (unsigned long)iperf_last.kbps);
+    }
+
+    if (n <= 0) return 0;
+    return (n < size) ? (u16_t)n : (u16_t)(size - 1);
+}
@@ -19,6 +19,16 @@
 #include "enc28j60.h"
 #include "tcp_echo.h"
 #include "http_server.h"
+#include "http_sse.h"
+#include "metrics.h"
+#include "console.h"
+#include "fw_update.h"
+#include "status_cache.h"
+#include "udp_cmd.h"
+#include "coap_server.h"
+#include "idle.h"
+#include "mem_watch.h"
+#include "iperf_server.h"
 #if LWIP_DHCP
 #include "lwip/dhcp.h"  // <-- Needed if DHCP is enabled
 #include "thingspeak.h"
@@ -40,7 +50,11 @@ static void MX_USART2_UART_Init(void);
 
 int main(void)
 {
+  mem_watch_paint();      // Before anything runs deep or malloc()s: stack high-water
   HAL_Init();
+#if FW_UPDATE_ENABLE
+  fw_update_boot_check(); // Installs a staged firmware image (does not return if it does)
+#endif
   SystemClock_Config();
   MX_GPIO_Init();
   MX_SPI1_Init();
@@ -74,7 +88,7 @@ int main(void)
 
   henc.Init.DuplexMode = ETH_MODE_HALFDUPLEX; // Forced Half-Duplex
   henc.Init.ChecksumMode = ETH_CHECKSUM_BY_HARDWARE;
-  henc.Init.InterruptEnableBits = 0;
+  henc.Init.InterruptEnableBits = IDLE_ENC_INT ? EIE_PKTIE : 0; // INT only wakes idle_sleep()
 
   // 4. Start Driver
   sprintf(msg, "Initializing Hardware Driver...\r\n");
@@ -95,11 +109,17 @@ int main(void)
     HAL_UART_Transmit(&huart2, (uint8_t*)"MAC Updated.\r\n", 14, 100);
 
   // 5. LwIP Init
+  metrics_init();         // 1us timestamps for /metrics
+  idle_init();            // Sleep between timeouts (uses TIM2)
   lwip_init();
+  mem_watch_init();       // Periodic stack high-water scan
 #if !USE_DHCP
   app_echoserver_init();  // Starts the Echo Server (Port 7)
 #endif
   http_server_init();     // Starts your HTTP Server (Port 80) <--- Add this
+  udp_cmd_init();         // Binary GPIO commands (UDP 5005)
+  coap_server_init();     // CoAP resources (UDP 5683)
+  iperf_server_init();    // iperf2 throughput tests (TCP 5001)
 
   // 6. IP Settings
   ip4_addr_t ipaddr, netmask, gw;
@@ -118,6 +138,9 @@ int main(void)
   // 7. Add Interface
   netif_add(&gnetif, &ipaddr, &netmask, &gw, NULL, &ethernetif_init, &ethernet_input);
   netif_set_default(&gnetif);
+#if !USE_DHCP
+  status_cache_set_ip(ipaddr.addr);
+#endif
 
   if (netif_is_link_up(&gnetif)) {
       netif_set_up(&gnetif);
@@ -157,6 +180,7 @@ int main(void)
   {
     ethernetif_input(&gnetif);
     sys_check_timeouts();
+    console_poll();
 
 #if USE_DHCP
   // Check if DHCP has assigned an IP address yet
@@ -168,6 +192,7 @@ int main(void)
 	  snprintf(ip_msg, sizeof(ip_msg), "\r\n>>> SUCCESS! DHCP IP is: %lu.%lu.%lu.%lu <<<\r\n",
 	  (my_ip & 0xff), ((my_ip >> 8) & 0xff), ((my_ip >> 16) & 0xff), (my_ip >> 24));
 	  HAL_UART_Transmit(&huart2, (uint8_t*)ip_msg, strlen(ip_msg), 100);
+	  status_cache_set_ip(my_ip);
 	  dhcp_ip_printed = 1; // Stop checking
    }
   }
@@ -184,7 +209,14 @@ int main(void)
 	 static int ts_counter = 0;
 	 int uptime_seconds = HAL_GetTick() / 1000;
 
-	 thingspeak_send(uptime_seconds, ts_counter++);
+	 thingspeak_send(uptime_seconds, ts_counter);
+
+	 // Push the same sample to any open dashboards
+	 char ev[48];
+	 snprintf(ev, sizeof(ev), "{\"uptime\":%d,\"count\":%d}", uptime_seconds, ts_counter);
+	 http_sse_publish("telemetry", ev);
+	 status_cache_set_telemetry(uptime_seconds, ts_counter);
+	 ts_counter++;
   }
 #endif
 
@@ -195,8 +227,12 @@ int main(void)
   {
 	 last_arp_time = HAL_GetTick();
 	 HAL_GPIO_TogglePin(LED_BLUE_GPIO_Port, LED_BLUE_Pin);
+	 status_cache_bump(); // The LED is part of /api/status
   }
 #endif
+
+  // Nothing left to do until the next timeout, frame or key
+  idle_sleep();
   }
 }
 
@@ -0,0 +1,77 @@
+/* Core/Src/mem_budget.c
+ *
+ * RAM breakdown of the lwIP memory profile (lwip_profile.h).
+ *
+ * The budget is exported as the absolute symbol lwip_ram_budget, which the
+ * linker script compares with the size of .bss.lwip_ram; the render below
+ * lists what fills that section, pool by pool, from the same descriptors
+ * memp.c uses.
+ */
+
+#include "mem_budget.h"
+#include "lwip/memp.h"
+#include <stdio.h>
+
+#define MEM_BUDGET_STR_(x)    #x
+#define MEM_BUDGET_STR(x)     MEM_BUDGET_STR_(x)
+
+__asm__(".global lwip_ram_budget\n\t"
+        ".set lwip_ram_budget, " MEM_BUDGET_STR(LWIP_PROFILE_RAM_BUDGET));
+
+/* Pool names, in memp_t order */
+static const char *const mem_budget_pool_names[MEMP_MAX] = {
+#define LWIP_MEMPOOL(name,num,size,desc) #name,
+#include "lwip/priv/memp_std.h"
+};
+
+/* Bytes a pool takes in .bss.lwip_ram (as LWIP_MEMPOOL_DECLARE sizes it) */
+static u32_t mem_budget_pool_bytes(memp_t t)
+{
+    return LWIP_MEM_ALIGN_BUFFER((u32_t)memp_pools[t]->num * (MEMP_SIZE + memp_pools[t]->size));
+}
+
+u16_t mem_budget_render(uint16_t *cursor, char *buf, u16_t size)
+{
+    uint16_t pos = (*cursor)++;
+    int n;
+
+    if (pos == 0)
+    {
+        n = snprintf(buf, size, "profile %s: MSS %u, wnd %u, snd_buf %u, budget %u B",
+                     LWIP_PROFILE_NAME, (unsigned)TCP_MSS, (unsigned)TCP_WND,
+                     (unsigned)TCP_SND_BUF, (unsigned)LWIP_PROFILE_RAM_BUDGET);
+    }
+    else if (pos <= MEMP_MAX)
+    {
+        memp_t t = (memp_t)(pos - 1);
+
+        n = snprintf(buf, size, "  %-16s %3u x %4u = %5lu", mem_budget_pool_names[t],
+                     (unsigned)memp_pools[t]->num, (unsigned)memp_pools[t]->size,
+                     (unsigned long)mem_budget_pool_bytes(t));
+    }
+    else if (pos == MEMP_MAX + 1)
+    {
+        u32_t total = 0;
+        memp_t t;
+
+        for (t = (memp_t)0; t < MEMP_MAX; t = (memp_t)(t + 1))
+        {
+            total += mem_budget_pool_bytes(t);
+        }
+#if !MEM_USE_POOLS && !MEM_LIBC_MALLOC
+        total += LWIP_MEM_ALIGN_BUFFER(MEM_SIZE);
+        n = snprintf(buf, size, "  heap %u, total %lu of %u B", (unsigned)MEM_SIZE,
+                     (unsigned long)total, (unsigned)LWIP_PROFILE_RAM_BUDGET);
+#else
+        n = snprintf(buf, size, "  total %lu of %u B", (unsigned long)total,
+                     (unsigned)LWIP_PROFILE_RAM_BUDGET);
+#endif
+    }
+    else
+    {
+        return 0;
+    }
+
+    if (n <= 0) return 0;
+    return (n < size) ? (u16_t)n : (u16_t)(size - 1);
+}
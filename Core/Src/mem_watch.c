@@ -0,0 +1,143 @@
+/* Core/Src/mem_watch.c
+ *
+ * RAM high-water report: MSP stack, newlib heap and lwIP pools.
+ *
+ * Stack: at boot every free word between the heap end (_sbrk(0)) and the
+ * stack pointer is painted. The stack only ever grows down into that area,
+ * so the lowest word no longer holding the pattern is its deepest point. The
+ * periodic scan starts at the heap end (malloc may have taken painted words
+ * since) and stops at the deepest point already known, so it only re-reads
+ * memory nothing has touched yet.
+ *
+ * Heap: _sbrk() never gives memory back, so its end is the high-water mark.
+ * lwIP: the pool and heap "max" counters kept by the stats (LWIP_STATS).
+ */
+
+#include "mem_watch.h"
+#include "main.h"
+#include "lwip/timeouts.h"
+#include "lwip/stats.h"
+#include "lwip/memp.h"
+#include <stddef.h>
+#include <stdio.h>
+
+#define MEM_WATCH_PATTERN   0xA5A5A5A5U
+
+extern uint8_t _end;            // Linker script: start of the newlib heap
+extern uint8_t _estack;         // Linker script: top of RAM (initial MSP)
+extern uint32_t _Min_Stack_Size;
+
+void *_sbrk(ptrdiff_t incr);
+
+static uint32_t *mem_watch_low;     // Deepest word the stack has written
+
+#if LWIP_STATS && MEMP_STATS
+/* Pool names, in memp_t order */
+static const char *const mem_watch_pool_names[MEMP_MAX] = {
+#define LWIP_MEMPOOL(name,num,size,desc) #name,
+#include "lwip/priv/memp_std.h"
+};
+#define MEM_WATCH_POOLS     MEMP_MAX
+#else
+#define MEM_WATCH_POOLS     0
+#endif
+
+/* First whole word above the newlib heap */
+static uint32_t *mem_watch_heap_end(void)
+{
+    return (uint32_t *)(((uintptr_t)_sbrk(0) + 3U) & ~(uintptr_t)3U);
+}
+
+void mem_watch_paint(void)
+{
+    uint32_t *p = mem_watch_heap_end();
+    uint32_t *top = (uint32_t *)((__get_MSP() - MEM_WATCH_GUARD) & ~3U);
+
+    while (p < top)
+    {
+        *p++ = MEM_WATCH_PATTERN;
+    }
+    mem_watch_low = top;
+}
+
+static void mem_watch_scan(void)
+{
+    uint32_t *p = mem_watch_heap_end();
+
+    if (mem_watch_low == NULL) return; // Not painted
+
+    while (p < mem_watch_low && *p == MEM_WATCH_PATTERN)
+    {
+        p++;
+    }
+    mem_watch_low = p;
+}
+
+static void mem_watch_tmr(void *arg)
+{
+    LWIP_UNUSED_ARG(arg);
+    mem_watch_scan();
+    sys_timeout(MEM_WATCH_SCAN_MS, mem_watch_tmr, NULL);
+}
+
+void mem_watch_init(void)
+{
+    sys_timeout(MEM_WATCH_SCAN_MS, mem_watch_tmr, NULL);
+}
+
+u16_t mem_watch_render(uint16_t *cursor, char *buf, u16_t size)
+{
+    uint16_t pos = (*cursor)++;
+    int n;
+
+    if (pos == 0)
+    {
+        uint8_t *heap_end;
+
+        // Fresh figures for whoever asks, not the last periodic scan
+        mem_watch_scan();
+        heap_end = (uint8_t *)_sbrk(0);
+        n = snprintf(buf, size, "{\"stack\":{\"reserved\":%lu,\"used\":%lu,\"gap\":%lu},",
+                     (unsigned long)(uintptr_t)&_Min_Stack_Size,
+                     (unsigned long)(mem_watch_low ? &_estack - (uint8_t *)mem_watch_low : 0),
+                     (unsigned long)(mem_watch_low ? (uint8_t *)mem_watch_low - heap_end : 0));
+    }
+    else if (pos == 1)
+    {
+        // _sbrk() stops where the reserved stack starts
+        uintptr_t limit = (uintptr_t)&_estack - (uintptr_t)&_Min_Stack_Size;
+
+        n = snprintf(buf, size, "\"sbrk\":{\"used\":%lu,\"limit\":%lu},",
+                     (unsigned long)((uintptr_t)_sbrk(0) - (uintptr_t)&_end),
+                     (unsigned long)(limit - (uintptr_t)&_end));
+    }
+    else if (pos == 2)
+    {
+#if LWIP_STATS && MEM_STATS
+        n = snprintf(buf, size, "\"lwip\":{\"heap\":[%u,%u],\"pools\":{",
+                     (unsigned)lwip_stats.mem.max, (unsigned)lwip_stats.mem.avail);
+#else
+        n = snprintf(buf, size, "\"lwip\":{\"pools\":{");
+#endif
+    }
+#if MEM_WATCH_POOLS
+    else if (pos < 3 + MEM_WATCH_POOLS)
+    {
+        const struct stats_mem *m = lwip_stats.memp[pos - 3];
+
+        n = snprintf(buf, size, "%s\"%s\":[%u,%u]", (pos > 3) ? "," : "",
+                     mem_watch_pool_names[pos - 3], (unsigned)m->max, (unsigned)m->avail);
+    }
+#endif
+    else if (pos == 3 + MEM_WATCH_POOLS)
+    {
+        n = snprintf(buf, size, "}}}");
+    }
+    else
+    {
+        return 0;
+    }
+
+    if (n <= 0) return 0;
+    return (n < size) ? (u16_t)n : (u16_t)(size - 1);
+}
@@ -0,0 +1,191 @@
+/* Core/Src/metrics.c
+ *
+ * Latency histograms on top of a free-running microsecond timer.
+ *
+ * TIM2 (32-bit) counts at 1 MHz with no interrupt, so taking a timestamp is a
+ * single register read. Samples land in fixed buckets (Prometheus "le" style,
+ * stored non-cumulative and summed while rendering), so recording is O(buckets)
+ * with no allocation. A few plain event counters follow the histograms in
+ * the output. The text exposition is rendered one line at a time so
+ * the HTTP server can stream it through a small send buffer.
+ */
+
+#include "metrics.h"
+#include <stdio.h>
+
+/* Bucket upper bounds: 100us .. 1s */
+static const uint32_t metric_bounds_us[METRICS_BUCKETS] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 1000000
+};
+
+/* The same bounds as Prometheus wants to see them, in seconds */
+static const char *const metric_le[METRICS_BUCKETS + 1] = {
+    "0.0001", "0.00025", "0.0005", "0.001", "0.0025", "0.005",
+    "0.01", "0.025", "0.05", "0.1", "0.25", "1", "+Inf"
+};
+
+struct metric_hist {
+    uint32_t bucket[METRICS_BUCKETS + 1];
+    uint32_t count;
+    uint64_t sum_us;
+};
+
+/* help != NULL marks the first series of a family (emits # HELP / # TYPE) */
+struct metric_desc {
+    const char *family;
+    const char *label;
+    const char *help;
+};
+
+static const struct metric_desc metric_desc[METRIC_COUNT] = {
+    { "http_stage_duration_seconds", "stage=\"first_byte\"", "Time between HTTP connection stages" },
+    { "http_stage_duration_seconds", "stage=\"receive\"",    NULL },
+    { "http_stage_duration_seconds", "stage=\"handler\"",    NULL },
+    { "http_stage_duration_seconds", "stage=\"ack_wait\"",   NULL },
+    { "http_stage_duration_seconds", "stage=\"total\"",      NULL },
+    { "eth_spi_duration_seconds",    "dir=\"tx\"",           "Time spent moving one frame over SPI" },
+    { "eth_spi_duration_seconds",    "dir=\"rx\"",           NULL },
+};
+
+static struct metric_hist metric_hist[METRIC_COUNT];
+
+static const struct metric_desc metric_counter_desc[METRIC_CNT_COUNT] = {
+    { "http_deadline_aborts_total", "deadline=\"first_byte\"", "Connections reset for sending their request too slowly" },
+    { "http_deadline_aborts_total", "deadline=\"headers\"",    NULL },
+    { "http_deadline_aborts_total", "deadline=\"body_rate\"",  NULL },
+};
+
+static uint32_t metric_counter[METRIC_CNT_COUNT];
+
+/* Cursor layout: series index in the upper bits, line within the series below */
+#define METRIC_LINE_BITS    5
+#define METRIC_LINE_MASK    ((1U << METRIC_LINE_BITS) - 1U)
+#define METRIC_LINE_SUM     (2 + METRICS_BUCKETS + 1)
+#define METRIC_LINE_COUNT   (METRIC_LINE_SUM + 1)
+
+void metrics_init(void)
+{
+    uint32_t clk = HAL_RCC_GetPCLK1Freq();
+
+    // Timers run at twice PCLK whenever the APB prescaler is not 1
+    if ((RCC->CFGR & RCC_CFGR_PPRE) != 0)
+    {
+        clk *= 2U;
+    }
+
+    __HAL_RCC_TIM2_CLK_ENABLE();
+    TIM2->CR1 = 0;
+    TIM2->PSC = (clk / 1000000U) - 1U; // 1 tick = 1us
+    TIM2->ARR = 0xFFFFFFFFU;
+    TIM2->CNT = 0;
+    TIM2->EGR = TIM_EGR_UG;            // Load PSC now instead of at the first wrap
+    TIM2->CR1 = TIM_CR1_CEN;
+}
+
+void metrics_observe(metric_id_t id, uint32_t us)
+{
+    struct metric_hist *h;
+    uint8_t i;
+
+    if (id >= METRIC_COUNT) return;
+    h = &metric_hist[id];
+
+    for (i = 0; i < METRICS_BUCKETS && us > metric_bounds_us[i]; i++)
+    {
+    }
+    h->bucket[i]++;
+    h->count++;
+    h->sum_us += us;
+}
+
+void metrics_count(metric_counter_t id)
+{
+    if (id < METRIC_CNT_COUNT) metric_counter[id]++;
+}
+
+/* One line of a counter series: HELP, TYPE, then the value */
+static int metrics_render_counter(uint8_t id, uint8_t line, char *buf, u16_t size)
+{
+    const struct metric_desc *d = &metric_counter_desc[id];
+
+    if (line == 0 && d->help != NULL)
+    {
+        return snprintf(buf, size, "# HELP %s %s\n", d->family, d->help);
+    }
+    if (line == 1 && d->help != NULL)
+    {
+        return snprintf(buf, size, "# TYPE %s counter\n", d->family);
+    }
+    if (line == 2)
+    {
+        return snprintf(buf, size, "%s{%s} %lu\n", d->family, d->label,
+                        (unsigned long)metric_counter[id]);
+    }
+    return 0;
+}
+
+u16_t metrics_render(uint16_t *cursor, char *buf, u16_t size)
+{
+    while ((*cursor >> METRIC_LINE_BITS) < METRIC_COUNT + METRIC_CNT_COUNT)
+    {
+        uint8_t id = (uint8_t)(*cursor >> METRIC_LINE_BITS);
+        uint8_t line = (uint8_t)(*cursor & METRIC_LINE_MASK);
+        uint8_t last = METRIC_LINE_COUNT;
+        const struct metric_desc *d = &metric_desc[(id < METRIC_COUNT) ? id : 0];
+        const struct metric_hist *h = &metric_hist[(id < METRIC_COUNT) ? id : 0];
+        int n = 0;
+
+        if (id >= METRIC_COUNT)
+        {
+            n = metrics_render_counter((uint8_t)(id - METRIC_COUNT), line, buf, size);
+            last = 2;
+        }
+        else if (line == 0 && d->help != NULL)
+        {
+            n = snprintf(buf, size, "# HELP %s %s\n", d->family, d->help);
+        }
+        else if (line == 1 && d->help != NULL)
+        {
+            n = snprintf(buf, size, "# TYPE %s histogram\n", d->family);
+        }
+        else if (line >= 2 && line < METRIC_LINE_SUM)
+        {
+            uint32_t cum = 0;
+            uint8_t i;
+
+            for (i = 0; i <= line - 2; i++)
+            {
+                cum += h->bucket[i];
+            }
+            n = snprintf(buf, size, "%s_bucket{%s,le=\"%s\"} %lu\n",
+                         d->family, d->label, metric_le[line - 2], (unsigned long)cum);
+        }
+        else if (line == METRIC_LINE_SUM)
+        {
+            n = snprintf(buf, size, "%s_sum{%s} %lu.%06lu\n", d->family, d->label,
+                         (unsigned long)(h->sum_us / 1000000U),
+                         (unsigned long)(h->sum_us % 1000000U));
+        }
+        else if (line == METRIC_LINE_COUNT)
+        {
+            n = snprintf(buf, size, "%s_count{%s} %lu\n", d->family, d->label,
+                         (unsigned long)h->count);
+        }
+
+        // Next line, or the first line of the next series
+        if (line >= last)
+        {
+            *cursor = (uint16_t)((id + 1U) << METRIC_LINE_BITS);
+        }
+        else
+        {
+            (*cursor)++;
+        }
+
+        if (n > 0)
+        {
+            return (n < size) ? (u16_t)n : (u16_t)(size - 1);
+        }
+    }
+    return 0;
+}
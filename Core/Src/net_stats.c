@@ -0,0 +1,150 @@
+/* Core/Src/net_stats.c
+ *
+ * Compact JSON view of lwip_stats (LWIP_STATS in lwipopts.h).
+ *
+ * The stack keeps these counters anyway; this only formats them. Rendering
+ * is done one piece at a time so the same code feeds the HTTP endpoint
+ * (through the server's body generator) and the UART console.
+ */
+
+#include "net_stats.h"
+#include "lwip/stats.h"
+#include "lwip/memp.h"
+#include <stdio.h>
+
+#if LWIP_STATS
+
+/* Pool names, in memp_t order */
+static const char *const net_stats_pool_names[MEMP_MAX] = {
+#define LWIP_MEMPOOL(name,num,size,desc) #name,
+#include "lwip/priv/memp_std.h"
+};
+
+/* Pieces after the pools */
+enum {
+    NET_STATS_POOLS_END = 0,
+    NET_STATS_HEAP_CLASSES,
+    NET_STATS_LINK,
+    NET_STATS_ARP,
+    NET_STATS_TCP,
+    NET_STATS_TCP_SEG,
+    NET_STATS_DONE
+};
+
+static int net_stats_mem(char *buf, u16_t size, const char *prefix, const struct stats_mem *m)
+{
+    return snprintf(buf, size, "%s[%u,%u,%u,%u]", prefix,
+                    (unsigned)m->used, (unsigned)m->max, (unsigned)m->avail, (unsigned)m->err);
+}
+
+#if MEM_USE_POOLS && MEM_STATS && MEMP_STATS
+/*
+ * mem_malloc() size classes: the largest allocation that would still succeed
+ * (biggest class with a free slot) and the bytes taken beyond what was asked
+ * for. Slots never split or merge, so this rounding is the only fragmentation.
+ */
+static int net_stats_heap_classes(char *buf, u16_t size)
+{
+    u32_t held = 0;
+    u16_t largest = 0;
+    memp_t t;
+
+    for (t = MEMP_POOL_FIRST; t <= MEMP_POOL_LAST; t = (memp_t)(t + 1))
+    {
+        const struct stats_mem *m = lwip_stats.memp[t];
+        u16_t usable = (u16_t)(memp_pools[t]->size - LWIP_MEM_ALIGN_SIZE(sizeof(struct memp_malloc_helper)));
+
+        held += (u32_t)m->used * usable;
+        if (m->used < m->avail) largest = usable;
+    }
+    return snprintf(buf, size, ",\"heap_classes\":{\"largest\":%u,\"held\":%lu,\"waste\":%lu}",
+                    (unsigned)largest, (unsigned long)held,
+                    (unsigned long)(held - lwip_stats.mem.used));
+}
+#endif
+
+u16_t net_stats_render(uint16_t *cursor, char *buf, u16_t size)
+{
+    while (*cursor <= MEMP_MAX + 1 + NET_STATS_DONE)
+    {
+        uint16_t i = (*cursor)++;
+        int n = 0;
+
+        if (i == 0)
+        {
+#if MEM_STATS
+            n = net_stats_mem(buf, size, "{\"heap\":", &lwip_stats.mem);
+            if (n > 0 && n < size) n += snprintf(buf + n, size - n, ",\"pools\":{");
+#else
+            n = snprintf(buf, size, "{\"pools\":{");
+#endif
+        }
+        else if (i <= MEMP_MAX)
+        {
+#if MEMP_STATS
+            char prefix[24];
+            snprintf(prefix, sizeof(prefix), "%s\"%s\":", (i > 1) ? "," : "", net_stats_pool_names[i - 1]);
+            n = net_stats_mem(buf, size, prefix, lwip_stats.memp[i - 1]);
+#endif
+        }
+        else switch (i - MEMP_MAX - 1)
+        {
+        case NET_STATS_POOLS_END:
+            n = snprintf(buf, size, "}");
+            break;
+#if MEM_USE_POOLS && MEM_STATS && MEMP_STATS
+        case NET_STATS_HEAP_CLASSES:
+            n = net_stats_heap_classes(buf, size);
+            break;
+#endif
+#if LINK_STATS
+        case NET_STATS_LINK:
+            n = snprintf(buf, size, ",\"link\":{\"rx\":%u,\"tx\":%u,\"drop\":%u,\"memerr\":%u,\"err\":%u}",
+                         (unsigned)lwip_stats.link.recv, (unsigned)lwip_stats.link.xmit,
+                         (unsigned)lwip_stats.link.drop, (unsigned)lwip_stats.link.memerr,
+                         (unsigned)lwip_stats.link.err);
+            break;
+#endif
+#if ETHARP_STATS
+        case NET_STATS_ARP:
+            n = snprintf(buf, size, ",\"arp\":{\"rx\":%u,\"tx\":%u,\"drop\":%u}",
+                         (unsigned)lwip_stats.etharp.recv, (unsigned)lwip_stats.etharp.xmit,
+                         (unsigned)lwip_stats.etharp.drop);
+            break;
+#endif
+#if TCP_STATS
+        case NET_STATS_TCP:
+            n = snprintf(buf, size, ",\"tcp\":{\"rx\":%u,\"tx\":%u,\"drop\":%u,\"memerr\":%u",
+                         (unsigned)lwip_stats.tcp.recv, (unsigned)lwip_stats.tcp.xmit,
+                         (unsigned)lwip_stats.tcp.drop, (unsigned)lwip_stats.tcp.memerr);
+            break;
+        case NET_STATS_TCP_SEG:
+            n = snprintf(buf, size, ",\"rexmit\":%u,\"ooseq\":%u}",
+                         (unsigned)lwip_stats.tcp_seg.rexmit, (unsigned)lwip_stats.tcp_seg.ooseq);
+            break;
+#endif
+        case NET_STATS_DONE:
+            n = snprintf(buf, size, "}");
+            break;
+        default:
+            break;
+        }
+
+        if (n > 0)
+        {
+            return (n < size) ? (u16_t)n : (u16_t)(size - 1);
+        }
+    }
+    return 0;
+}
+
+#else /* LWIP_STATS */
+
+u16_t net_stats_render(uint16_t *cursor, char *buf, u16_t size)
+{
+    if (*cursor != 0) return 0;
+    (*cursor)++;
+    return (u16_t)snprintf(buf, size, "{}");
+}
+
+#endif /* LWIP_STATS */
@@ -0,0 +1,140 @@
+/* Core/Src/rate_limit.c
+ *
+ * Per-source-IP token buckets for the HTTP listener.
+ *
+ * Tokens are kept in thousandths so the refill (RATE_LIMIT_PER_SEC per second)
+ * is exact with integer math: elapsed_ms * RATE_LIMIT_PER_SEC milli-tokens.
+ * Buckets are refilled lazily when their client shows up again.
+ */
+
+#include "rate_limit.h"
+#include "lwip/sys.h"
+#include <stdio.h>
+#include <string.h>
+
+#define RATE_TOKEN          1000U
+#define RATE_CAPACITY       (RATE_LIMIT_BURST * RATE_TOKEN)
+
+struct rate_client {
+    u32_t ip;           // 0 = free slot
+    u32_t tokens;       // Milli-tokens
+    u32_t last_ms;      // Last refill
+    u32_t passed;
+    u32_t throttled;
+    u32_t rejected;
+};
+
+static struct rate_client rate_clients[RATE_LIMIT_CLIENTS];
+static u32_t rate_throttled_total;
+static u32_t rate_rejected_total;
+
+/* Existing entry, else a free one, else the one idle the longest */
+static struct rate_client *rate_lookup(u32_t ip, u32_t now)
+{
+    struct rate_client *victim = &rate_clients[0];
+    uint8_t i;
+
+    for (i = 0; i < RATE_LIMIT_CLIENTS; i++)
+    {
+        struct rate_client *c = &rate_clients[i];
+
+        if (c->ip == ip)
+        {
+            return c;
+        }
+        if (victim->ip != 0 && (c->ip == 0 || (now - c->last_ms) > (now - victim->last_ms)))
+        {
+            victim = c;
+        }
+    }
+
+    memset(victim, 0, sizeof(*victim));
+    victim->ip = ip;
+    victim->tokens = RATE_CAPACITY;
+    victim->last_ms = now;
+    return victim;
+}
+
+rate_verdict_t rate_limit_check(u32_t ip, uint8_t critical)
+{
+    u32_t now = sys_now();
+    struct rate_client *c = rate_lookup(ip, now);
+    u32_t elapsed = now - c->last_ms;
+
+    // 1. Refill (capped, and without overflowing on long idle times)
+    if (elapsed >= RATE_CAPACITY / RATE_LIMIT_PER_SEC)
+    {
+        c->tokens = RATE_CAPACITY;
+    }
+    else
+    {
+        c->tokens += elapsed * RATE_LIMIT_PER_SEC;
+        if (c->tokens > RATE_CAPACITY) c->tokens = RATE_CAPACITY;
+    }
+    c->last_ms = now;
+
+    // 2. Spend
+    if (c->tokens >= RATE_TOKEN)
+    {
+        c->tokens -= RATE_TOKEN;
+        c->passed++;
+        return RATE_PASS;
+    }
+
+    // 3. Over the limit: a 429 still costs a PCB and a reply, a RST costs nothing
+    if (critical)
+    {
+        c->rejected++;
+        rate_rejected_total++;
+        return RATE_REJECT;
+    }
+    c->throttled++;
+    rate_throttled_total++;
+    return RATE_THROTTLE;
+}
+
+u16_t rate_limit_render(uint16_t *cursor, char *buf, u16_t size)
+{
+    uint8_t first = 1;
+    uint8_t i;
+    int n = 0;
+
+    while (*cursor <= RATE_LIMIT_CLIENTS + 1)
+    {
+        uint16_t pos = (*cursor)++;
+
+        if (pos == 0)
+        {
+            n = snprintf(buf, size, "{\"clients\":[");
+        }
+        else if (pos <= RATE_LIMIT_CLIENTS)
+        {
+            const struct rate_client *c = &rate_clients[pos - 1];
+            const u8_t *a = (const u8_t *)&c->ip;
+
+            if (c->ip == 0) continue;
+
+            // Comma unless this is the first used slot
+            for (i = 0; i < pos - 1; i++)
+            {
+                if (rate_clients[i].ip != 0) first = 0;
+            }
+            n = snprintf(buf, size,
+                         "%s{\"ip\":\"%u.%u.%u.%u\",\"tokens\":%lu,\"pass\":%lu,\"throttled\":%lu,\"reset\":%lu}",
+                         first ? "" : ",", a[0], a[1], a[2], a[3],
+                         (unsigned long)(c->tokens / RATE_TOKEN), (unsigned long)c->passed,
+                         (unsigned long)c->throttled, (unsigned long)c->rejected);
+        }
+        else
+        {
+            n = snprintf(buf, size, "],\"throttled\":%lu,\"reset\":%lu}",
+                         (unsigned long)rate_throttled_total, (unsigned long)rate_rejected_total);
+        }
+
+        if (n > 0)
+        {
+            return (n < size) ? (u16_t)n : (u16_t)(size - 1);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,245 @@
+/* Core/Src/self_bench.c
+ *
+ * On-device benchmark of the frame path building blocks.
+ *
+ * Everything is timed with the 1 us TIM2 counter (metrics_now_us), so the
+ * figures only move with the core clock, the SPI prescaler and the code.
+ * Test data is the start of flash. ENC SRAM transfers use the TX buffer as
+ * scratch. The loopback frame is addressed to our own MAC and the PHY loops
+ * transmissions back (enc_set_loopback); in half duplex it also goes out on
+ * the wire, where no other station has that address.
+ *
+ * Pieces can run inside lwIP callbacks (/api/bench), where netif->input must
+ * not be re-entered, so other frames received while waiting for the
+ * loopback are held (ethernetif_hold_frame) and reach lwIP from the main
+ * loop right after.
+ */
+
+#include "self_bench.h"
+#include "main.h"
+#include "metrics.h"
+#include "ethernetif.h"
+#include "lwip/pbuf.h"
+#include "lwip/netif.h"
+#include "lwip/prot/ethernet.h"
+#include "enc28j60.h"
+#include <stdio.h>
+#include <string.h>
+
+#define SELF_BENCH_SRC  ((const uint8_t *)FLASH_BASE)
+
+extern ENC_HandleTypeDef henc;
+extern SPI_HandleTypeDef hspi1;
+extern struct netif gnetif;
+
+/* 1000 bytes per second; bytes stays far below 4 MB */
+static u32_t self_bench_kBps(u32_t bytes, u32_t us)
+{
+    return us ? bytes * 1000U / us : 0;
+}
+
+static int self_bench_spi(char *buf, u16_t size)
+{
+    u32_t div = 2U << ((hspi1.Instance->CR1 & SPI_CR1_BR) >> SPI_CR1_BR_Pos);
+
+    return snprintf(buf, size, "{\"spi\":{\"div\":%lu,\"hz\":%lu},",
+                    (unsigned long)div, (unsigned long)(HAL_RCC_GetPCLK1Freq() / div));
+}
+
+/* Flash -> TX buffer and back into RAM, one SPI burst per transfer */
+static int self_bench_sram(char *buf, u16_t size)
+{
+    struct pbuf *p = pbuf_alloc(PBUF_RAW, SELF_BENCH_SRAM_LEN, PBUF_RAM);
+    u32_t t0, t_wr, t_rd;
+    uint8_t i, ok = 1;
+
+    if (p == NULL)
+    {
+        return snprintf(buf, size, "\"sram\":null,");
+    }
+
+    t0 = metrics_now_us();
+    for (i = 0; i < SELF_BENCH_RUNS; i++)
+    {
+        if (enc_scratch_write(&henc, SELF_BENCH_SRC, SELF_BENCH_SRAM_LEN) != 0) ok = 0;
+    }
+    t_wr = metrics_now_us() - t0;
+
+    t0 = metrics_now_us();
+    for (i = 0; i < SELF_BENCH_RUNS; i++)
+    {
+        enc_scratch_read(&henc, p->payload, SELF_BENCH_SRAM_LEN);
+    }
+    t_rd = metrics_now_us() - t0;
+
+    if (memcmp(p->payload, SELF_BENCH_SRC, SELF_BENCH_SRAM_LEN) != 0) ok = 0;
+    pbuf_free(p);
+
+    return snprintf(buf, size, "\"sram\":{\"len\":%u,\"wr_kBps\":%lu,\"rd_kBps\":%lu,\"ok\":%s},",
+                    (unsigned)SELF_BENCH_SRAM_LEN,
+                    (unsigned long)self_bench_kBps(SELF_BENCH_SRAM_LEN * SELF_BENCH_RUNS, t_wr),
+                    (unsigned long)self_bench_kBps(SELF_BENCH_SRAM_LEN * SELF_BENCH_RUNS, t_rd),
+                    ok ? "true" : "false");
+}
+
+/* EPKTCNT: a bank register read, as the main loop does for every poll */
+static int self_bench_reg(char *buf, u16_t size)
+{
+    u32_t t0 = metrics_now_us();
+    uint8_t i;
+
+    for (i = 0; i < SELF_BENCH_REG_RUNS; i++)
+    {
+        enc_packet_receive_status(&henc);
+    }
+    return snprintf(buf, size, "\"reg_ns\":%lu,",
+                    (unsigned long)((metrics_now_us() - t0) * 1000U / SELF_BENCH_REG_RUNS));
+}
+
+/* LWIP_CHKSUM over a full segment in RAM, as for every TCP segment */
+static int self_bench_chksum(char *buf, u16_t size)
+{
+    struct pbuf *p = pbuf_alloc(PBUF_RAW, TCP_MSS, PBUF_RAM);
+    u32_t t0, t;
+    uint8_t i;
+
+    if (p == NULL)
+    {
+        return snprintf(buf, size, "\"chksum\":null,");
+    }
+    MEMCPY(p->payload, SELF_BENCH_SRC, TCP_MSS);
+
+    t0 = metrics_now_us();
+    for (i = 0; i < SELF_BENCH_RUNS; i++)
+    {
+        LWIP_CHKSUM(p->payload, TCP_MSS);
+    }
+    t = metrics_now_us() - t0;
+    pbuf_free(p);
+
+    return snprintf(buf, size, "\"chksum\":{\"len\":%u,\"kBps\":%lu},",
+                    (unsigned)TCP_MSS, (unsigned long)self_bench_kBps(TCP_MSS * SELF_BENCH_RUNS, t));
+}
+
+/* pbuf_copy() from a PBUF_POOL chain (a received segment) into one PBUF_RAM */
+static int self_bench_pbuf_copy(char *buf, u16_t size)
+{
+    struct pbuf *src = pbuf_alloc(PBUF_RAW, TCP_MSS, PBUF_POOL);
+    struct pbuf *dst = pbuf_alloc(PBUF_RAW, TCP_MSS, PBUF_RAM);
+    u32_t t0, t;
+    uint8_t i;
+    int n;
+
+    if (src == NULL || dst == NULL)
+    {
+        n = snprintf(buf, size, "\"pbuf_copy\":null,");
+    }
+    else
+    {
+        pbuf_take(src, SELF_BENCH_SRC, TCP_MSS);
+
+        t0 = metrics_now_us();
+        for (i = 0; i < SELF_BENCH_RUNS; i++)
+        {
+            pbuf_copy(dst, src);
+        }
+        t = metrics_now_us() - t0;
+
+        n = snprintf(buf, size, "\"pbuf_copy\":{\"len\":%u,\"kBps\":%lu},",
+                     (unsigned)TCP_MSS, (unsigned long)self_bench_kBps(TCP_MSS * SELF_BENCH_RUNS, t));
+    }
+    if (src != NULL) pbuf_free(src);
+    if (dst != NULL) pbuf_free(dst);
+    return n;
+}
+
+/* One frame to ourselves through low_level_output() and low_level_input() */
+static int self_bench_loopback(char *buf, u16_t size)
+{
+    struct netif *netif = &gnetif;
+    struct pbuf *p = pbuf_alloc(PBUF_RAW, SELF_BENCH_FRAME_LEN, PBUF_RAM);
+    struct eth_hdr *eth;
+    u32_t t0, sent, t_tx = 0, t_wire = 0, t_rx = 0;
+    uint8_t seen = 0, ok = 0;
+
+    if (p == NULL)
+    {
+        return snprintf(buf, size, "\"loopback\":null}");
+    }
+    pbuf_take(p, SELF_BENCH_SRC, SELF_BENCH_FRAME_LEN);
+    eth = (struct eth_hdr *)p->payload;
+    SMEMCPY(&eth->dest, netif->hwaddr, ETH_HWADDR_LEN);
+    SMEMCPY(&eth->src, netif->hwaddr, ETH_HWADDR_LEN);
+    eth->type = PP_HTONS(SELF_BENCH_TYPE);
+
+    enc_set_loopback(&henc, true);
+
+    // 1. Out through the driver, as lwIP sends
+    t0 = metrics_now_us();
+    if (netif->linkoutput(netif, p) == ERR_OK)
+    {
+        sent = metrics_now_us();
+        t_tx = sent - t0;
+
+        // 2. Back in: wait for the receive count, then read the frame
+        while (!seen && (u32_t)(metrics_now_us() - sent) < SELF_BENCH_FRAME_WAIT_US)
+        {
+            struct pbuf *r;
+
+            if (!enc_packet_receive_status(&henc)) continue;
+
+            t0 = metrics_now_us();
+            t_wire = t0 - sent;
+            r = ethernetif_read_frame(netif);
+            t_rx = metrics_now_us() - t0;
+
+            if (r != NULL)
+            {
+                // Ours when the header matches; anything else goes to lwIP later
+                if (pbuf_memcmp(r, 0, p->payload, SIZEOF_ETH_HDR) == 0)
+                {
+                    seen = 1;
+                    ok = (r->tot_len == SELF_BENCH_FRAME_LEN &&
+                          pbuf_memcmp(r, 0, p->payload, SELF_BENCH_FRAME_LEN) == 0);
+                    pbuf_free(r);
+                }
+                else
+                {
+                    ethernetif_hold_frame(r);
+                }
+            }
+        }
+    }
+
+    enc_set_loopback(&henc, false);
+    pbuf_free(p);
+
+    if (!seen)
+    {
+        return snprintf(buf, size, "\"loopback\":{\"len\":%u,\"tx_us\":%lu,\"ok\":false}}",
+                        (unsigned)SELF_BENCH_FRAME_LEN, (unsigned long)t_tx);
+    }
+    return snprintf(buf, size, "\"loopback\":{\"len\":%u,\"tx_us\":%lu,\"wire_us\":%lu,\"rx_us\":%lu,\"ok\":%s}}",
+                    (unsigned)SELF_BENCH_FRAME_LEN, (unsigned long)t_tx, (unsigned long)t_wire,
+                    (unsigned long)t_rx, ok ? "true" : "false");
+}
+
+u16_t self_bench_render(uint16_t *cursor, char *buf, u16_t size)
+{
+    uint16_t pos = (*cursor)++;
+    int n;
+
+    switch (pos)
+    {
+    case 0: n = self_bench_spi(buf, size); break;
+    case 1: n = self_bench_sram(buf, size); break;
+    case 2: n = self_bench_reg(buf, size); break;
+    case 3: n = self_bench_chksum(buf, size); break;
+    case 4: n = self_bench_pbuf_copy(buf, size); break;
+    case 5: n = self_bench_loopback(buf, size); break;
+    default: return 0;
+    }
+
+    if (n <= 0) return 0;
+    return (n < size) ? (u16_t)n : (u16_t)(size - 1);
+}
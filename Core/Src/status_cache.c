@@ -0,0 +1,175 @@
+/* Core/Src/status_cache.c
+ *
+ * Render-once cache for GET /api/status.
+ *
+ * Every value in the status document has a single writer that calls
+ * status_cache_bump(), so a version counter tells whether the last rendered
+ * response is still valid. Dashboards polling in between get the same bytes
+ * back without any formatting. The ETag is a hash of the exact body bytes,
+ * "version" included, so it is a strong validator (RFC 9110 8.8.3): two
+ * responses with the same tag are byte for byte the same.
+ */
+
+#include "status_cache.h"
+#include "cmd_exec.h"
+#include <stdio.h>
+#include <string.h>
+
+static uint32_t status_version = 1;     // Bumped on every state change
+static uint32_t status_cached = 0;      // Version held in the buffers below
+
+static uint32_t status_uptime_s;
+static uint32_t status_count;
+static uint32_t status_ip;
+
+static char status_200[STATUS_CACHE_SIZE];
+static u16_t status_200_len;
+static u16_t status_body_len;           // JSON body at the end of status_200
+static char status_304[64];
+static u16_t status_304_len;
+static char status_etag[12];            // "xxxxxxxx" including the quotes
+
+void status_cache_bump(void)
+{
+    status_version++;
+}
+
+void status_cache_set_telemetry(uint32_t uptime_s, uint32_t count)
+{
+    status_uptime_s = uptime_s;
+    status_count = count;
+    status_cache_bump();
+}
+
+void status_cache_set_ip(uint32_t ip)
+{
+    status_ip = ip;
+    status_cache_bump();
+}
+
+/* FNV-1a: cheap and good enough to tell two status documents apart */
+static uint32_t status_hash(const char *s, u16_t len)
+{
+    uint32_t h = 2166136261UL;
+
+    while (len--)
+    {
+        h ^= (uint8_t)*s++;
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+static void status_render(void)
+{
+    char body[128];
+    const uint8_t *ip = (const uint8_t *)&status_ip;
+    int n;
+
+    // cmd_led_json() is {"led":"..."}: splice it in without its closing brace
+    n = snprintf(body, sizeof(body),
+                 "%.*s,\"ip\":\"%u.%u.%u.%u\",\"uptime\":%lu,\"count\":%lu,\"version\":%lu}",
+                 (int)strlen(cmd_led_json()) - 1, cmd_led_json(),
+                 ip[0], ip[1], ip[2], ip[3],
+                 (unsigned long)status_uptime_s, (unsigned long)status_count,
+                 (unsigned long)status_version);
+    if (n < 0 || n >= (int)sizeof(body)) n = (int)sizeof(body) - 1;
+    status_body_len = (u16_t)n;
+
+    snprintf(status_etag, sizeof(status_etag), "\"%08lx\"", (unsigned long)status_hash(body, (u16_t)n));
+
+    n = snprintf(status_200, sizeof(status_200),
+                 "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                 "Cache-Control: no-cache\r\nETag: %s\r\nContent-Length: %d\r\n\r\n%s",
+                 status_etag, n, body);
+    status_200_len = (u16_t)((n < (int)sizeof(status_200)) ? n : (int)sizeof(status_200) - 1);
+    if (status_body_len > status_200_len) status_body_len = status_200_len;
+
+    n = snprintf(status_304, sizeof(status_304), "HTTP/1.1 304 Not Modified\r\nETag: %s\r\n\r\n", status_etag);
+    status_304_len = (u16_t)((n < (int)sizeof(status_304)) ? n : (int)sizeof(status_304) - 1);
+
+    status_cached = status_version;
+}
+
+/*
+ * If-None-Match: "*" or a comma-separated list of entity tags, each possibly
+ * W/ prefixed. The weak comparison applies (RFC 9110 13.1.2), so W/"x" still
+ * matches "x", but the opaque tag itself must be identical.
+ */
+static uint8_t status_inm_match(const char *inm, u16_t inm_len)
+{
+    const char *end = inm + inm_len;
+    const char *tag;
+    u16_t tag_len, etag_len = (u16_t)strlen(status_etag);
+
+    // The header value ends at its line
+    for (tag = inm; tag < end; tag++)
+    {
+        if (*tag == '\r' || *tag == '\n')
+        {
+            end = tag;
+            break;
+        }
+    }
+
+    while (inm < end)
+    {
+        while (inm < end && (*inm == ' ' || *inm == '\t' || *inm == ',')) inm++;
+        if (inm == end) break;
+
+        // One element: "*" or a quoted tag, followed only by spaces up to the comma
+        if (*inm == '*')
+        {
+            tag = inm++;
+        }
+        else
+        {
+            if (end - inm >= 2 && inm[0] == 'W' && inm[1] == '/') inm += 2;
+            tag = inm;
+            if (inm < end && *inm == '"')
+            {
+                for (inm++; inm < end && *inm != '"'; inm++) {}
+                if (inm < end) inm++;
+            }
+        }
+        tag_len = (u16_t)(inm - tag);
+        while (inm < end && (*inm == ' ' || *inm == '\t')) inm++;
+        if (inm < end && *inm != ',')
+        {
+            while (inm < end && *inm != ',') inm++; // Malformed element
+            continue;
+        }
+
+        if (tag_len == 1 && *tag == '*') return 1;
+        if (tag_len == etag_len && memcmp(tag, status_etag, etag_len) == 0) return 1;
+    }
+    return 0;
+}
+
+const char *status_cache_get(const char *inm, u16_t inm_len, u16_t *len)
+{
+    if (status_cached != status_version)
+    {
+        status_render();
+    }
+
+    if (inm != NULL && status_inm_match(inm, inm_len))
+    {
+        *len = status_304_len;
+        return status_304;
+    }
+
+    *len = status_200_len;
+    return status_200;
+}
+
+const char *status_cache_body(u16_t *len)
+{
+    if (status_cached != status_version)
+    {
+        status_render();
+    }
+
+    *len = status_body_len;
+    return status_200 + status_200_len - status_body_len;
+}
@@ -22,6 +22,7 @@
 #include "stm32g0xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "idle.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -142,4 +143,30 @@ void SysTick_Handler(void)
 
 /* USER CODE BEGIN 1 */
 
+/**
+  * @brief This function handles TIM2 global interrupt (idle wake-up).
+  */
+void TIM2_IRQHandler(void)
+{
+  idle_tim_irq();
+}
+
+/**
+  * @brief This function handles USART2 global interrupt (idle wake-up).
+  */
+void USART2_IRQHandler(void)
+{
+  idle_uart_irq();
+}
+
+#if IDLE_ENC_INT
+/**
+  * @brief This function handles EXTI line 4 to 15 interrupts (ENC28J60 INT).
+  */
+void EXTI4_15_IRQHandler(void)
+{
+  HAL_GPIO_EXTI_IRQHandler(IDLE_ENC_INT_Pin);
+}
+#endif
+
 /* USER CODE END 1 */
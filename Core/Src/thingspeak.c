@@ -6,6 +6,7 @@
 #include "thingspeak.h"
 #include "lwip/tcp.h"
 #include "lwip/dns.h"
+#include "http_tmpl.h"
 #include <string.h>
 #include <stdio.h>
 
@@ -29,12 +30,16 @@ typedef struct {
 
 static thingspeak_app_t ts;
 
+// Outcome of the last upload, shown on the web page (<!--#ts-->)
+static char ts_result[24] = "none yet";
+
 static void ts_close(void);
 static void ts_dns_found(const char *name, const ip_addr_t *ipaddr, void *callback_arg);
 static err_t ts_connected(void *arg, struct tcp_pcb *tpcb, err_t err);
 static err_t ts_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
 static void ts_error(void *arg, err_t err);
 static err_t ts_poll(void *arg, struct tcp_pcb *tpcb);
+static u16_t ts_tag_result(char *buf, u16_t size);
 
 static void TS_Log(char *msg) {
     HAL_UART_Transmit(&huart2, (uint8_t*)msg, strlen(msg), 100);
@@ -43,6 +48,7 @@ static void TS_Log(char *msg) {
 void thingspeak_init(void) {
     memset(&ts, 0, sizeof(ts));
     ts.state = TS_STATE_IDLE;
+    http_tmpl_register("ts", ts_tag_result);
     TS_Log("ThingSpeak: Client Initialized (IDLE)\r\n");
 }
 
@@ -88,6 +94,7 @@ static void ts_dns_found(const char *name, const ip_addr_t *ipaddr, void *callba
         }
     } else {
         TS_Log("ThingSpeak: DNS Failed (No IP)\r\n");
+        snprintf(ts_result, sizeof(ts_result), "DNS failed");
         ts_close();
     }
 }
@@ -138,6 +145,10 @@ static err_t ts_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err)
         int len = (p->len < 63) ? p->len : 63;
         memcpy(rx_buf, p->payload, len);
         rx_buf[len] = '\0';
+        // Status line of the reply: "HTTP/1.1 200 OK"
+        if (strncmp(rx_buf, "HTTP/1.", 7) == 0 && len >= 12) {
+            snprintf(ts_result, sizeof(ts_result), "HTTP %.3s", rx_buf + 9);
+        }
         TS_Log("RX Reply: "); TS_Log(rx_buf); TS_Log("\r\n");
     }
 
@@ -166,6 +177,7 @@ static void ts_error(void *arg, err_t err) {
     char buf[32];
     snprintf(buf, sizeof(buf), "ThingSpeak: TCP Error %d\r\n", err);
     TS_Log(buf);
+    snprintf(ts_result, sizeof(ts_result), "TCP error %d", err);
     ts.state = TS_STATE_IDLE;
     ts.pcb = NULL;
 }
@@ -182,3 +194,7 @@ static void ts_close(void) {
     }
     ts.state = TS_STATE_IDLE;
 }
+
+static u16_t ts_tag_result(char *buf, u16_t size) {
+    return (u16_t)snprintf(buf, size, "%s", ts_result);
+}
@@ -0,0 +1,202 @@
+/* Core/Src/udp_cmd.c
+ *
+ * Fire-and-forget GPIO control over UDP.
+ *
+ * One datagram in, at most one out: no handshake, no text parsing. Commands
+ * go through cmd_batch_execute(), the same path as POST /api/cmd, so SSE
+ * subscribers and the status cache see UDP changes too.
+ *
+ * The frame handling itself (udp_cmd_process) is shared with the raw
+ * Ethernet channel in eth_cmd.c.
+ *
+ * Senders may retransmit when an ACK is lost. The last sequence number and
+ * reply status of each sender are remembered, so a repeated frame is
+ * answered again but never applied twice, and a late frame overtaken by a
+ * newer one is dropped instead of undoing it.
+ */
+
+#include "udp_cmd.h"
+#include "cmd_exec.h"
+#include "lwip/udp.h"
+#include "lwip/sys.h"
+#include <string.h>
+
+struct udp_cmd_peer {
+    uint8_t key[UDP_CMD_KEY_LEN];   // Sender identity (address + port, or MAC)
+    uint8_t used;
+    u16_t seq;          // Last sequence number applied
+    uint8_t status;     // ...and what it was answered with
+    u32_t last_ms;
+};
+
+static struct udp_cmd_peer udp_cmd_peers[UDP_CMD_PEERS];
+
+/* Existing entry for this sender, else a free or the least recently used one */
+static struct udp_cmd_peer *udp_cmd_peer(const uint8_t *key, uint8_t *fresh)
+{
+    struct udp_cmd_peer *victim = &udp_cmd_peers[0];
+    uint8_t i;
+
+    for (i = 0; i < UDP_CMD_PEERS; i++)
+    {
+        struct udp_cmd_peer *c = &udp_cmd_peers[i];
+
+        if (c->used && memcmp(c->key, key, UDP_CMD_KEY_LEN) == 0)
+        {
+            *fresh = 0;
+            return c;
+        }
+        if (victim->used && (!c->used || c->last_ms - victim->last_ms > 0x7FFFFFFFU))
+        {
+            victim = c;
+        }
+    }
+
+    memcpy(victim->key, key, UDP_CMD_KEY_LEN);
+    victim->used = 1;
+    *fresh = 1;
+    return victim;
+}
+
+/* Drive every output named in mask; all of them switch in one BSRR write per port */
+static udp_cmd_status_t udp_cmd_set(u16_t mask, u16_t value)
+{
+    cmd_item_t items[CMD_BATCH_MAX];
+    uint8_t count = 0;
+    uint8_t i;
+
+    if (mask >> cmd_output_count())
+    {
+        return UDP_CMD_BAD_OUTPUT;
+    }
+
+    for (i = 0; i < cmd_output_count() && count < CMD_BATCH_MAX; i++)
+    {
+        if (mask & (1U << i))
+        {
+            items[count].output = i;
+            items[count].action = (value & (1U << i)) ? CMD_ON : CMD_OFF;
+            items[count].hold_ms = 0;
+            count++;
+        }
+    }
+
+    if (count > 0)
+    {
+        cmd_batch_execute(items, count);
+    }
+    return UDP_CMD_OK;
+}
+
+static void udp_cmd_reply(const uint8_t *f, uint8_t status, uint8_t *reply)
+{
+    u16_t states = cmd_output_states();
+
+    reply[0] = (uint8_t)(f[0] | UDP_CMD_OP_REPLY);
+    reply[1] = status;
+    reply[2] = f[2];    // seq, as received
+    reply[3] = f[3];
+    reply[4] = (uint8_t)(states >> 8);
+    reply[5] = (uint8_t)states;
+    reply[6] = 0;
+    reply[7] = 0;
+}
+
+uint8_t udp_cmd_process(const uint8_t *f, const uint8_t *key, uint8_t *reply)
+{
+    struct udp_cmd_peer *peer;
+    uint8_t fresh;
+    u16_t seq = (u16_t)((f[2] << 8) | f[3]);
+    uint8_t status;
+
+    // 1. Reads are harmless to repeat: no sequence tracking
+    if (f[0] == UDP_CMD_OP_READ)
+    {
+        status = UDP_CMD_OK;
+    }
+    else if (f[0] != UDP_CMD_OP_SET)
+    {
+        status = UDP_CMD_BAD_FRAME;
+    }
+    else
+    {
+        // 2. Replay handling: same seq -> same answer, older seq -> not applied
+        peer = udp_cmd_peer(key, &fresh);
+        peer->last_ms = sys_now();
+
+        if (!fresh && seq != 0 && seq == peer->seq)
+        {
+            status = peer->status;
+        }
+        else if (!fresh && seq != 0 && (s16_t)(seq - peer->seq) < 0)
+        {
+            status = UDP_CMD_STALE;
+        }
+        else
+        {
+            status = (uint8_t)udp_cmd_set((u16_t)((f[4] << 8) | f[5]), (u16_t)((f[6] << 8) | f[7]));
+            peer->seq = seq;
+            peer->status = status;
+        }
+    }
+
+    if (!(f[1] & UDP_CMD_FLAG_ACK))
+    {
+        return 0;
+    }
+    udp_cmd_reply(f, status, reply);
+    return 1;
+}
+
+static void udp_cmd_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+                         const ip_addr_t *addr, u16_t port)
+{
+    uint8_t f[UDP_CMD_FRAME_LEN];
+    uint8_t key[UDP_CMD_KEY_LEN];
+    uint8_t reply[UDP_CMD_FRAME_LEN];
+    struct pbuf *q;
+
+    LWIP_UNUSED_ARG(arg);
+
+    // Exact length only
+    if (p->tot_len != UDP_CMD_FRAME_LEN || pbuf_copy_partial(p, f, sizeof(f), 0) != sizeof(f))
+    {
+        pbuf_free(p);
+        return;
+    }
+    pbuf_free(p);
+
+    // Sender identity: IPv4 address and port
+    memset(key, 0, sizeof(key));
+    memcpy(key, &ip_2_ip4(addr)->addr, 4);
+    key[4] = (uint8_t)(port >> 8);
+    key[5] = (uint8_t)port;
+    key[UDP_CMD_KEY_LEN - 1] = UDP_CMD_KEY_UDP;
+
+    // Only a sender that asked for a reply costs a pbuf
+    if (!udp_cmd_process(f, key, reply))
+    {
+        return;
+    }
+
+    q = pbuf_alloc(PBUF_TRANSPORT, UDP_CMD_FRAME_LEN, PBUF_RAM);
+    if (q == NULL) return; // The sender retries; a repeated seq gets the same answer
+
+    memcpy(q->payload, reply, UDP_CMD_FRAME_LEN);
+    udp_sendto(pcb, q, addr, port);
+    pbuf_free(q);
+}
+
+void udp_cmd_init(void)
+{
+    struct udp_pcb *pcb = udp_new();
+
+    if (pcb == NULL) return;
+
+    if (udp_bind(pcb, IP_ADDR_ANY, UDP_CMD_PORT) != ERR_OK)
+    {
+        udp_remove(pcb);
+        return;
+    }
+    udp_recv(pcb, udp_cmd_recv, NULL);
+}
@@ -65,7 +65,17 @@ u16_t lwip_standard_chksum(const void *dataptr, int len);
 # define LWIP_CHKSUM_ALGORITHM 0
 #endif
 
-#if (LWIP_CHKSUM_ALGORITHM == 1) /* Version #1 */
+/* LWIP_CHKSUM_BENCH: build all reference versions under their own names */
+#if LWIP_CHKSUM_BENCH
+# if LWIP_CHKSUM_ALGORITHM != 0
+#  error "LWIP_CHKSUM_BENCH needs LWIP_CHKSUM set to your own routine"
+# endif
+# define LWIP_CHKSUM_REF(n) lwip_chksum_alg##n
+#else
+# define LWIP_CHKSUM_REF(n) lwip_standard_chksum
+#endif
+
+#if (LWIP_CHKSUM_ALGORITHM == 1) || LWIP_CHKSUM_BENCH /* Version #1 */
 /**
  * lwip checksum
  *
@@ -77,7 +87,7 @@ u16_t lwip_standard_chksum(const void *dataptr, int len);
  * @note host endianess is irrelevant (p3 RFC1071)
  */
 u16_t
-lwip_standard_chksum(const void *dataptr, int len)
+LWIP_CHKSUM_REF(1)(const void *dataptr, int len)
 {
   u32_t acc;
   u16_t src;
@@ -114,7 +124,7 @@ lwip_standard_chksum(const void *dataptr, int len)
 }
 #endif
 
-#if (LWIP_CHKSUM_ALGORITHM == 2) /* Alternative version #2 */
+#if (LWIP_CHKSUM_ALGORITHM == 2) || LWIP_CHKSUM_BENCH /* Alternative version #2 */
 /*
  * Curt McDowell
  * Broadcom Corp.
@@ -130,7 +140,7 @@ lwip_standard_chksum(const void *dataptr, int len)
  * @return host order (!) lwip checksum (non-inverted Internet sum)
  */
 u16_t
-lwip_standard_chksum(const void *dataptr, int len)
+LWIP_CHKSUM_REF(2)(const void *dataptr, int len)
 {
   const u8_t *pb = (const u8_t *)dataptr;
   const u16_t *ps;
@@ -173,7 +183,7 @@ lwip_standard_chksum(const void *dataptr, int len)
 }
 #endif
 
-#if (LWIP_CHKSUM_ALGORITHM == 3) /* Alternative version #3 */
+#if (LWIP_CHKSUM_ALGORITHM == 3) || LWIP_CHKSUM_BENCH /* Alternative version #3 */
 /**
  * An optimized checksum routine. Basically, it uses loop-unrolling on
  * the checksum loop, treating the head and tail bytes specially, whereas
@@ -186,7 +196,7 @@ lwip_standard_chksum(const void *dataptr, int len)
  * by Curt McDowell, Broadcom Corp. December 8th, 2005
  */
 u16_t
-lwip_standard_chksum(const void *dataptr, int len)
+LWIP_CHKSUM_REF(3)(const void *dataptr, int len)
 {
   const u8_t *pb = (const u8_t *)dataptr;
   const u16_t *ps;
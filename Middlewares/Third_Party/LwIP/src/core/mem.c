@@ -154,11 +154,21 @@ mem_overflow_init_raw(void *p, size_t size)
 #if MEM_LIBC_MALLOC || MEM_USE_POOLS
 
 /** mem_init is not used when using pools instead of a heap or using
- * C library malloc().
+ * C library malloc(). With pools, it only records their capacity in the stats.
  */
 void
 mem_init(void)
 {
+#if MEM_USE_POOLS && LWIP_STATS && MEM_STATS
+  mem_size_t avail = 0;
+  memp_t poolnr;
+
+  for (poolnr = MEMP_POOL_FIRST; poolnr <= MEMP_POOL_LAST; poolnr = (memp_t)(poolnr + 1)) {
+    avail += (mem_size_t)(memp_pools[poolnr]->num *
+                          (memp_pools[poolnr]->size - LWIP_MEM_ALIGN_SIZE(sizeof(struct memp_malloc_helper))));
+  }
+  MEM_STATS_AVAIL(avail, avail);
+#endif /* MEM_USE_POOLS && LWIP_STATS && MEM_STATS */
 }
 
 /** mem_trim is not used when using pools instead of a heap or using
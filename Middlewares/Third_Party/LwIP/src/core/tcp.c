@@ -184,6 +184,11 @@ struct tcp_pcb **const tcp_pcb_lists[] = {&tcp_listen_pcbs.pcbs, &tcp_bound_pcbs
 
 u8_t tcp_active_pcbs_changed;
 
+#if LWIP_TCP_PCB_HASH
+/** Active and TIME-WAIT pcbs by connection, chained through hash_next */
+struct tcp_pcb *tcp_pcb_hash[TCP_PCB_HASH_SIZE];
+#endif /* LWIP_TCP_PCB_HASH */
+
 /** Timer counter to handle calling slow-timer from tcp_tmr() */
 static u8_t tcp_timer;
 static u8_t tcp_timer_ctr;
@@ -1393,6 +1398,9 @@ tcp_slowtmr_start:
         LWIP_ASSERT("tcp_slowtmr: first pcb == tcp_active_pcbs", tcp_active_pcbs == pcb);
         tcp_active_pcbs = pcb->next;
       }
+#if LWIP_TCP_PCB_HASH
+      tcp_pcb_hash_remove(pcb);
+#endif /* LWIP_TCP_PCB_HASH */
 
       if (pcb_reset) {
         tcp_rst(pcb, pcb->snd_nxt, pcb->rcv_nxt, &pcb->local_ip, &pcb->remote_ip,
@@ -1459,6 +1467,9 @@ tcp_slowtmr_start:
         LWIP_ASSERT("tcp_slowtmr: first pcb == tcp_tw_pcbs", tcp_tw_pcbs == pcb);
         tcp_tw_pcbs = pcb->next;
       }
+#if LWIP_TCP_PCB_HASH
+      tcp_pcb_hash_remove(pcb);
+#endif /* LWIP_TCP_PCB_HASH */
       pcb2 = pcb;
       pcb = pcb->next;
       tcp_free(pcb2);
@@ -2206,6 +2217,68 @@ tcp_pcb_remove(struct tcp_pcb **pcblist, struct tcp_pcb *pcb)
   LWIP_ASSERT("tcp_pcb_remove: tcp_pcbs_sane()", tcp_pcbs_sane());
 }
 
+#if LWIP_TCP_PCB_HASH
+/**
+ * Bucket of a connection in tcp_pcb_hash. The local address is left out:
+ * it rarely differs between connections of a small host.
+ *
+ * @param local_port local port (host byte order)
+ * @param remote_port remote port (host byte order)
+ * @param remote_ip remote address
+ * @return index into tcp_pcb_hash
+ */
+u8_t
+tcp_pcb_hash_index(u16_t local_port, u16_t remote_port, const ip_addr_t *remote_ip)
+{
+  u32_t h = (u32_t)local_port ^ ((u32_t)remote_port << 16);
+
+#if LWIP_IPV4 && LWIP_IPV6
+  if (IP_IS_V6(remote_ip)) {
+    h ^= ip_2_ip6(remote_ip)->addr[3];
+  } else {
+    h ^= ip4_addr_get_u32(ip_2_ip4(remote_ip));
+  }
+#elif LWIP_IPV6
+  h ^= ip_2_ip6(remote_ip)->addr[3];
+#else
+  h ^= ip4_addr_get_u32(ip_2_ip4(remote_ip));
+#endif
+  h ^= h >> 16;
+  h ^= h >> 8;
+  return (u8_t)(h & (TCP_PCB_HASH_SIZE - 1));
+}
+
+/**
+ * Adds a pcb that was just put on the active or TIME-WAIT list to tcp_pcb_hash.
+ */
+void
+tcp_pcb_hash_add(struct tcp_pcb *pcb)
+{
+  u8_t i = tcp_pcb_hash_index(pcb->local_port, pcb->remote_port, &pcb->remote_ip);
+
+  pcb->hash_next = tcp_pcb_hash[i];
+  tcp_pcb_hash[i] = pcb;
+}
+
+/**
+ * Removes a pcb leaving the active or TIME-WAIT list from tcp_pcb_hash.
+ * Its connection must not have changed since tcp_pcb_hash_add().
+ */
+void
+tcp_pcb_hash_remove(struct tcp_pcb *pcb)
+{
+  struct tcp_pcb **pp = &tcp_pcb_hash[tcp_pcb_hash_index(pcb->local_port, pcb->remote_port, &pcb->remote_ip)];
+
+  for (; *pp != NULL; pp = &(*pp)->hash_next) {
+    if (*pp == pcb) {
+      *pp = pcb->hash_next;
+      break;
+    }
+  }
+  pcb->hash_next = NULL;
+}
+#endif /* LWIP_TCP_PCB_HASH */
+
 /**
  * Calculates a new initial sequence number for new connections.
  *
@@ -118,6 +118,9 @@ void
 tcp_input(struct pbuf *p, struct netif *inp)
 {
   struct tcp_pcb *pcb, *prev;
+#if LWIP_TCP_PCB_HASH
+  struct tcp_pcb *hash_head;
+#endif /* LWIP_TCP_PCB_HASH */
   struct tcp_pcb_listen *lpcb;
 #if SO_REUSE
   struct tcp_pcb *lpcb_prev = NULL;
@@ -247,7 +250,16 @@ tcp_input(struct pbuf *p, struct netif *inp)
      for an active connection. */
   prev = NULL;
 
+#if LWIP_TCP_PCB_HASH
+  /* Only the bucket of this connection can hold its active or TIME-WAIT pcb */
+  hash_head = tcp_pcb_hash[tcp_pcb_hash_index(tcphdr->dest, tcphdr->src, ip_current_src_addr())];
+  for (pcb = hash_head; pcb != NULL; pcb = pcb->hash_next) {
+    if (pcb->state == TIME_WAIT) {
+      continue;
+    }
+#else /* LWIP_TCP_PCB_HASH */
   for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+#endif /* LWIP_TCP_PCB_HASH */
     LWIP_ASSERT("tcp_input: active pcb->state != CLOSED", pcb->state != CLOSED);
     LWIP_ASSERT("tcp_input: active pcb->state != TIME-WAIT", pcb->state != TIME_WAIT);
     LWIP_ASSERT("tcp_input: active pcb->state != LISTEN", pcb->state != LISTEN);
@@ -265,13 +277,16 @@ tcp_input(struct pbuf *p, struct netif *inp)
         ip_addr_cmp(&pcb->local_ip, ip_current_dest_addr())) {
       /* Move this PCB to the front of the list so that subsequent
          lookups will be faster (we exploit locality in TCP segment
-         arrivals). */
+         arrivals). Not needed when the lookup is hashed. */
       LWIP_ASSERT("tcp_input: pcb->next != pcb (before cache)", pcb->next != pcb);
+#if !LWIP_TCP_PCB_HASH
       if (prev != NULL) {
         prev->next = pcb->next;
         pcb->next = tcp_active_pcbs;
         tcp_active_pcbs = pcb;
-      } else {
+      } else
+#endif /* !LWIP_TCP_PCB_HASH */
+      {
         TCP_STATS_INC(tcp.cachehit);
       }
       LWIP_ASSERT("tcp_input: pcb->next != pcb (after cache)", pcb->next != pcb);
@@ -283,7 +298,14 @@ tcp_input(struct pbuf *p, struct netif *inp)
   if (pcb == NULL) {
     /* If it did not go to an active connection, we check the connections
        in the TIME-WAIT state. */
+#if LWIP_TCP_PCB_HASH
+    for (pcb = hash_head; pcb != NULL; pcb = pcb->hash_next) {
+      if (pcb->state != TIME_WAIT) {
+        continue;
+      }
+#else /* LWIP_TCP_PCB_HASH */
     for (pcb = tcp_tw_pcbs; pcb != NULL; pcb = pcb->next) {
+#endif /* LWIP_TCP_PCB_HASH */
       LWIP_ASSERT("tcp_input: TIME-WAIT pcb->state == TIME-WAIT", pcb->state == TIME_WAIT);
 
       /* check if PCB is bound to specific netif */
@@ -1643,6 +1665,7 @@ tcp_receive(struct tcp_pcb *pcb)
 
       } else {
         /* We get here if the incoming segment is out-of-sequence. */
+        TCP_STATS_INC(tcp_seg.ooseq);
 
 #if TCP_QUEUE_OOSEQ
         /* We queue the segment on the ->ooseq queue. */
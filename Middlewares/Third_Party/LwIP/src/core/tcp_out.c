@@ -100,6 +100,11 @@
   seg->flags |= TF_SEG_DATA_CHECKSUMMED; } while(0)
 #define TCP_DATA_COPY2(dst, src, len, chksum, chksum_swapped)  \
   tcp_seg_add_chksum(LWIP_CHKSUM_COPY(dst, src, len), len, chksum, chksum_swapped);
+#ifdef LWIP_HOOK_TCP_NOCOPY_CHKSUM
+#define TCP_NOCOPY_CHKSUM(src, len) LWIP_HOOK_TCP_NOCOPY_CHKSUM(src, len)
+#else
+#define TCP_NOCOPY_CHKSUM(src, len) ((u16_t)~inet_chksum(src, len))
+#endif
 #else /* TCP_CHECKSUM_ON_COPY*/
 #define TCP_DATA_COPY(dst, src, len, seg)                     MEMCPY(dst, src, len)
 #define TCP_DATA_COPY2(dst, src, len, chksum, chksum_swapped) MEMCPY(dst, src, len)
@@ -572,7 +577,7 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
         }
 #if TCP_CHECKSUM_ON_COPY
         /* calculate the checksum of nocopy-data */
-        tcp_seg_add_chksum(~inet_chksum((const u8_t *)arg + pos, seglen), seglen,
+        tcp_seg_add_chksum(TCP_NOCOPY_CHKSUM((const u8_t *)arg + pos, seglen), seglen,
                            &concat_chksum, &concat_chksum_swapped);
         concat_chksummed += seglen;
 #endif /* TCP_CHECKSUM_ON_COPY */
@@ -630,7 +635,7 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
       }
 #if TCP_CHECKSUM_ON_COPY
       /* calculate the checksum of nocopy-data */
-      chksum = ~inet_chksum((const u8_t *)arg + pos, seglen);
+      chksum = TCP_NOCOPY_CHKSUM((const u8_t *)arg + pos, seglen);
       if (seglen & 1) {
         chksum_swapped = 1;
         chksum = SWAP_BYTES_IN_WORD(chksum);
@@ -1691,6 +1696,7 @@ tcp_rexmit_rto_commit(struct tcp_pcb *pcb)
   if (pcb->nrtx < 0xFF) {
     ++pcb->nrtx;
   }
+  TCP_STATS_INC(tcp_seg.rexmit);
   /* Do the actual retransmission */
   tcp_output(pcb);
 }
@@ -1768,6 +1774,7 @@ tcp_rexmit(struct tcp_pcb *pcb)
 
   /* Do the actual retransmission. */
   MIB2_STATS_INC(mib2.tcpretranssegs);
+  TCP_STATS_INC(tcp_seg.rexmit);
   /* No need to call tcp_output: we are always called from tcp_input()
      and thus tcp_output directly returns. */
   return ERR_OK;
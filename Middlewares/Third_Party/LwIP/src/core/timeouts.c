@@ -118,11 +118,12 @@ const int lwip_num_cyclic_timers = LWIP_ARRAYSIZE(lwip_cyclic_timers);
 
 #if LWIP_TIMERS && !LWIP_TIMERS_CUSTOM
 
+static u32_t current_timeout_due_time;
+
+#if !LWIP_TIMERS_WHEEL
 /** The one and only timeout list */
 static struct sys_timeo *next_timeout;
 
-static u32_t current_timeout_due_time;
-
 #if LWIP_TESTMODE
 struct sys_timeo**
 sys_timeouts_get_next_timeout(void)
@@ -130,6 +131,144 @@ sys_timeouts_get_next_timeout(void)
   return &next_timeout;
 }
 #endif
+#endif /* !LWIP_TIMERS_WHEEL */
+
+#if LWIP_TIMERS_WHEEL
+/* Hierarchical timer wheel: TIMEO_WHEEL_LEVELS wheels of TIMEO_WHEEL_SLOTS
+   slots, one tick per sys_now() millisecond. A slot of level n holds the
+   timeouts due in one block of TIMEO_WHEEL_SLOTS^n ms; when the wheel time
+   enters a block, that slot is cascaded one level down, so every timeout is
+   handled at most TIMEO_WHEEL_LEVELS times whatever the number of timers. */
+#define TIMEO_WHEEL_BITS    5
+#define TIMEO_WHEEL_SLOTS   (1U << TIMEO_WHEEL_BITS)
+#define TIMEO_WHEEL_MASK    (TIMEO_WHEEL_SLOTS - 1)
+#define TIMEO_WHEEL_LEVELS  4
+/** Block size of one slot of a level */
+#define TIMEO_WHEEL_BLOCK(level) (1UL << (TIMEO_WHEEL_BITS * (level)))
+/** Deltas a level can hold (beyond the top one: parked, see timeo_wheel_insert) */
+#define TIMEO_WHEEL_SPAN(level)  TIMEO_WHEEL_BLOCK((level) + 1)
+
+/** Buckets for finding a timeout by handler and arg in sys_untimeout() */
+#define TIMEO_HASH_SIZE     8
+
+static struct sys_timeo *timeo_wheel[TIMEO_WHEEL_LEVELS][TIMEO_WHEEL_SLOTS];
+static struct sys_timeo *timeo_hash[TIMEO_HASH_SIZE];
+/** Wheel time: every timeout due at or before this has been run */
+static u32_t timeo_wheel_time;
+static u16_t timeo_count;
+
+static u8_t
+timeo_hash_index(sys_timeout_handler handler, void *arg)
+{
+  mem_ptr_t x = (mem_ptr_t)handler ^ (mem_ptr_t)arg;
+  x ^= x >> 7;
+  return (u8_t)((x >> 2) & (TIMEO_HASH_SIZE - 1));
+}
+
+static void
+timeo_hash_remove(struct sys_timeo *timeout)
+{
+  struct sys_timeo **pt = &timeo_hash[timeo_hash_index(timeout->h, timeout->arg)];
+
+  for (; *pt != NULL; pt = &(*pt)->hash_next) {
+    if (*pt == timeout) {
+      *pt = timeout->hash_next;
+      return;
+    }
+  }
+}
+
+/* Hooks timeout into the slot for its due time. From a cascade, an overdue
+   timeout runs with the current tick, otherwise with the next one (the
+   current slot may already have been run). */
+static void
+timeo_wheel_insert(struct sys_timeo *timeout, u8_t cascading)
+{
+  u32_t due = timeout->time;
+  u32_t delta;
+  u8_t level = 0;
+  struct sys_timeo **slot;
+
+  if (!TIME_LESS_THAN(timeo_wheel_time, due)) {
+    due = cascading ? timeo_wheel_time : (u32_t)(timeo_wheel_time + 1);
+  }
+  delta = due - timeo_wheel_time;
+  while ((level < TIMEO_WHEEL_LEVELS - 1) && (delta >= TIMEO_WHEEL_SPAN(level))) {
+    level++;
+  }
+  if (delta >= TIMEO_WHEEL_SPAN(level)) {
+    /* too far for the top level: park in its last slot, sorted again from there */
+    due = (u32_t)(timeo_wheel_time + TIMEO_WHEEL_SPAN(level) - 1);
+  }
+
+  slot = &timeo_wheel[level][(due >> (TIMEO_WHEEL_BITS * level)) & TIMEO_WHEEL_MASK];
+  timeout->next = *slot;
+  if (timeout->next != NULL) {
+    timeout->next->pprev = &timeout->next;
+  }
+  timeout->pprev = slot;
+  *slot = timeout;
+}
+
+static void
+timeo_wheel_unlink(struct sys_timeo *timeout)
+{
+  *timeout->pprev = timeout->next;
+  if (timeout->next != NULL) {
+    timeout->next->pprev = timeout->pprev;
+  }
+}
+
+/* Advances the wheel time by one tick and runs the timeouts of that tick */
+static void
+timeo_wheel_tick(void)
+{
+  u32_t now = ++timeo_wheel_time;
+  struct sys_timeo **slot;
+  struct sys_timeo *t;
+  u8_t level = 1;
+
+  /* 1. Entering a new block of level n also enters one of every level below
+        it: cascade from the highest such level down to level 1 */
+  while ((level < TIMEO_WHEEL_LEVELS) && ((now & (TIMEO_WHEEL_BLOCK(level) - 1)) == 0)) {
+    level++;
+  }
+  while (--level > 0) {
+    slot = &timeo_wheel[level][(now >> (TIMEO_WHEEL_BITS * level)) & TIMEO_WHEEL_MASK];
+    t = *slot;
+    *slot = NULL;
+    while (t != NULL) {
+      struct sys_timeo *next = t->next;
+      timeo_wheel_insert(t, 1);
+      t = next;
+    }
+  }
+
+  /* 2. Run this tick's slot; handlers only add timeouts to later slots, but
+        may remove any, so take them one at a time */
+  slot = &timeo_wheel[0][now & TIMEO_WHEEL_MASK];
+  while ((t = *slot) != NULL) {
+    sys_timeout_handler handler = t->h;
+    void *arg = t->arg;
+
+    timeo_wheel_unlink(t);
+    timeo_hash_remove(t);
+    timeo_count--;
+    current_timeout_due_time = t->time;
+#if LWIP_DEBUG_TIMERNAMES
+    if (handler != NULL) {
+      LWIP_DEBUGF(TIMERS_DEBUG, ("sct calling h=%s t=%"U32_F" arg=%p\n",
+                                 t->handler_name, sys_now() - t->time, arg));
+    }
+#endif /* LWIP_DEBUG_TIMERNAMES */
+    memp_free(MEMP_SYS_TIMEOUT, t);
+    if (handler != NULL) {
+      handler(arg);
+    }
+    LWIP_TCPIP_THREAD_ALIVE();
+  }
+}
+#endif /* LWIP_TIMERS_WHEEL */
 
 #if LWIP_TCP
 /** global variable that shows if the tcp timer is currently scheduled or not */
@@ -183,7 +322,10 @@ sys_timeout_abs(u32_t abs_time, sys_timeout_handler handler, void *arg, const ch
 sys_timeout_abs(u32_t abs_time, sys_timeout_handler handler, void *arg)
 #endif
 {
-  struct sys_timeo *timeout, *t;
+  struct sys_timeo *timeout;
+#if !LWIP_TIMERS_WHEEL
+  struct sys_timeo *t;
+#endif
 
   timeout = (struct sys_timeo *)memp_malloc(MEMP_SYS_TIMEOUT);
   if (timeout == NULL) {
@@ -202,6 +344,12 @@ sys_timeout_abs(u32_t abs_time, sys_timeout_handler handler, void *arg)
                              (void *)timeout, abs_time, handler_name, (void *)arg));
 #endif /* LWIP_DEBUG_TIMERNAMES */
 
+#if LWIP_TIMERS_WHEEL
+  timeout->hash_next = timeo_hash[timeo_hash_index(handler, arg)];
+  timeo_hash[timeo_hash_index(handler, arg)] = timeout;
+  timeo_count++;
+  timeo_wheel_insert(timeout, 0);
+#else /* LWIP_TIMERS_WHEEL */
   if (next_timeout == NULL) {
     next_timeout = timeout;
     return;
@@ -218,6 +366,7 @@ sys_timeout_abs(u32_t abs_time, sys_timeout_handler handler, void *arg)
       }
     }
   }
+#endif /* LWIP_TIMERS_WHEEL */
 }
 
 /**
@@ -264,6 +413,9 @@ lwip_cyclic_timer(void *arg)
 void sys_timeouts_init(void)
 {
   size_t i;
+#if LWIP_TIMERS_WHEEL
+  timeo_wheel_time = sys_now();
+#endif /* LWIP_TIMERS_WHEEL */
   /* tcp_tmr() at index 0 is started on demand */
   for (i = (LWIP_TCP ? 1 : 0); i < LWIP_ARRAYSIZE(lwip_cyclic_timers); i++) {
     /* we have to cast via size_t to get rid of const warning
@@ -305,6 +457,7 @@ sys_timeout(u32_t msecs, sys_timeout_handler handler, void *arg)
 #endif
 }
 
+#if !LWIP_TIMERS_WHEEL
 /**
  * Go through timeout list (for this task only) and remove the first matching
  * entry (subsequent entries remain untouched), even though the timeout has not
@@ -442,6 +595,147 @@ sys_timeouts_sleeptime(void)
   }
 }
 
+#else /* !LWIP_TIMERS_WHEEL */
+
+/**
+ * Remove a matching timeout, even though it has not triggered yet.
+ * With the timer wheel, this is not necessarily the first one that was added.
+ *
+ * @param handler callback function that would be called by the timeout
+ * @param arg callback argument that would be passed to handler
+*/
+void
+sys_untimeout(sys_timeout_handler handler, void *arg)
+{
+  struct sys_timeo *t;
+
+  LWIP_ASSERT_CORE_LOCKED();
+
+  for (t = timeo_hash[timeo_hash_index(handler, arg)]; t != NULL; t = t->hash_next) {
+    if ((t->h == handler) && (t->arg == arg)) {
+      timeo_wheel_unlink(t);
+      timeo_hash_remove(t);
+      timeo_count--;
+      memp_free(MEMP_SYS_TIMEOUT, t);
+      return;
+    }
+  }
+}
+
+/**
+ * @ingroup lwip_nosys
+ * Handle timeouts for NO_SYS==1: turn the wheel up to sys_now(), running
+ * the timeouts of every tick on the way.
+ *
+ * Must be called periodically from your main loop.
+ */
+void
+sys_check_timeouts(void)
+{
+  u32_t now;
+
+  LWIP_ASSERT_CORE_LOCKED();
+
+  now = sys_now();
+  while (TIME_LESS_THAN(timeo_wheel_time, now)) {
+    PBUF_CHECK_FREE_OOSEQ();
+    if (timeo_count == 0) {
+      /* nothing to run on the way */
+      timeo_wheel_time = now;
+      return;
+    }
+    timeo_wheel_tick();
+  }
+}
+
+/** Rebase the timeout times to the current time.
+ * This is necessary if sys_check_timeouts() hasn't been called for a long
+ * time (e.g. while saving energy) to prevent all timer functions of that
+ * period being called.
+ */
+void
+sys_restart_timeouts(void)
+{
+  u32_t now;
+  u32_t base;
+  struct sys_timeo *all = NULL;
+  struct sys_timeo *t;
+  u8_t level, i;
+
+  if (timeo_count == 0) {
+    return;
+  }
+
+  /* take every timeout off the wheel, noting the earliest */
+  base = 0;
+  for (level = 0; level < TIMEO_WHEEL_LEVELS; level++) {
+    for (i = 0; i < TIMEO_WHEEL_SLOTS; i++) {
+      while ((t = timeo_wheel[level][i]) != NULL) {
+        timeo_wheel[level][i] = t->next;
+        if ((all == NULL) || TIME_LESS_THAN(t->time, base)) {
+          base = t->time;
+        }
+        t->next = all;
+        all = t;
+      }
+    }
+  }
+
+  /* the earliest becomes due now, the others keep their distance */
+  now = sys_now();
+  timeo_wheel_time = (u32_t)(now - 1);
+  while (all != NULL) {
+    t = all;
+    all = t->next;
+    t->time = (t->time - base) + now;
+    timeo_wheel_insert(t, 0);
+  }
+}
+
+/** Return the time left before the next timeout is due. If no timeouts are
+ * enqueued, returns 0xffffffff
+ * The first occupied slot of level 0 gives it exactly; a slot of a higher
+ * level only gives the start of its block, which is never later than its
+ * timeouts, so at worst the caller wakes up early.
+ */
+u32_t
+sys_timeouts_sleeptime(void)
+{
+  u32_t now;
+  u32_t next = LWIP_MAX_TIMEOUT;
+  u32_t elapsed;
+  u8_t level, i;
+
+  LWIP_ASSERT_CORE_LOCKED();
+
+  if (timeo_count == 0) {
+    return SYS_TIMEOUTS_SLEEPTIME_INFINITE;
+  }
+
+  for (i = 1; i < TIMEO_WHEEL_SLOTS; i++) {
+    if (timeo_wheel[0][(timeo_wheel_time + i) & TIMEO_WHEEL_MASK] != NULL) {
+      next = i;
+      break;
+    }
+  }
+  for (level = 1; level < TIMEO_WHEEL_LEVELS; level++) {
+    u32_t block = timeo_wheel_time >> (TIMEO_WHEEL_BITS * level);
+    for (i = 1; i <= TIMEO_WHEEL_SLOTS; i++) {
+      if (timeo_wheel[level][(block + i) & TIMEO_WHEEL_MASK] != NULL) {
+        u32_t start = (u32_t)(((block + i) << (TIMEO_WHEEL_BITS * level)) - timeo_wheel_time);
+        next = LWIP_MIN(next, start);
+        break;
+      }
+    }
+  }
+
+  now = sys_now();
+  elapsed = TIME_LESS_THAN(timeo_wheel_time, now) ? (u32_t)(now - timeo_wheel_time) : 0;
+  return (next > elapsed) ? (next - elapsed) : 0;
+}
+
+#endif /* !LWIP_TIMERS_WHEEL */
+
 #else /* LWIP_TIMERS && !LWIP_TIMERS_CUSTOM */
 /* Satisfy the TCP code which calls this function */
 void
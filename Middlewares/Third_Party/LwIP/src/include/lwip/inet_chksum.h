@@ -76,6 +76,11 @@ u16_t inet_chksum_pbuf(struct pbuf *p);
 #if LWIP_CHKSUM_COPY_ALGORITHM
 u16_t lwip_chksum_copy(void *dst, const void *src, u16_t len);
 #endif /* LWIP_CHKSUM_COPY_ALGORITHM */
+#if LWIP_CHKSUM_BENCH
+u16_t lwip_chksum_alg1(const void *dataptr, int len);
+u16_t lwip_chksum_alg2(const void *dataptr, int len);
+u16_t lwip_chksum_alg3(const void *dataptr, int len);
+#endif /* LWIP_CHKSUM_BENCH */
 
 #if LWIP_IPV4
 u16_t inet_chksum_pseudo(struct pbuf *p, u8_t proto, u16_t proto_len,
@@ -120,6 +120,20 @@
 #if !defined LWIP_TIMERS_CUSTOM || defined __DOXYGEN__
 #define LWIP_TIMERS_CUSTOM              0
 #endif
+
+/**
+ * LWIP_TIMERS_WHEEL==1: Keep the timeouts in a hierarchical timer wheel
+ * instead of one sorted list. Adding and removing a timeout no longer walks
+ * the list, and sys_check_timeouts() turns the wheel one millisecond at a
+ * time. sys_timeouts_sleeptime() may then return less than the time to the
+ * next timeout (never more), a timeout added already due runs on the next
+ * millisecond, and sys_untimeout() removes any one matching timeout rather
+ * than the first. Not for LWIP_TESTMODE (the unit tests look
+ * at the list).
+ */
+#if !defined LWIP_TIMERS_WHEEL || defined __DOXYGEN__
+#define LWIP_TIMERS_WHEEL               0
+#endif
 /**
  * @}
  */
@@ -1386,6 +1400,22 @@
 #endif
 #endif
 
+/**
+ * LWIP_TCP_PCB_HASH==1: Index active and TIME-WAIT pcbs by their connection
+ * (ports and remote address) so tcp_input() finds the pcb of a segment
+ * without walking the whole lists. Costs one pointer per pcb plus the table.
+ */
+#if !defined LWIP_TCP_PCB_HASH || defined __DOXYGEN__
+#define LWIP_TCP_PCB_HASH               0
+#endif
+
+/**
+ * TCP_PCB_HASH_SIZE: Number of buckets of that index (power of two).
+ */
+#if !defined TCP_PCB_HASH_SIZE || defined __DOXYGEN__
+#define TCP_PCB_HASH_SIZE               8
+#endif
+
 /**
  * TCP_LISTEN_BACKLOG: Enable the backlog option for tcp listen pcb.
  */
@@ -2352,6 +2382,15 @@
 #if !defined LWIP_CHECKSUM_ON_COPY || defined __DOXYGEN__
 #define LWIP_CHECKSUM_ON_COPY           0
 #endif
+
+/**
+ * LWIP_CHKSUM_BENCH==1: Also build the reference checksum versions 1, 2 and 3
+ * as lwip_chksum_alg1..3, to benchmark them against your own LWIP_CHKSUM
+ * (which must be defined in that case).
+ */
+#if !defined LWIP_CHKSUM_BENCH || defined __DOXYGEN__
+#define LWIP_CHKSUM_BENCH               0
+#endif
 /**
  * @}
  */
@@ -2842,6 +2881,28 @@
 #define LWIP_HOOK_TCP_OUT_ADD_TCPOPTS(p, hdr, pcb, opts)
 #endif
 
+/**
+ * LWIP_HOOK_TCP_NOCOPY_CHKSUM:
+ * Hook for summing data passed to tcp_write() without TCP_WRITE_FLAG_COPY
+ * (only used with LWIP_CHECKSUM_ON_COPY==1).
+ * Signature:\code{.c}
+ * u16_t my_hook_tcp_nocopy_chksum(const void *dataptr, u16_t len);
+ * \endcode
+ * Arguments:
+ * - dataptr: start of the referenced data
+ * - len: its length
+ * Return value:
+ * - the ones-complement sum of the data, folded to 16 bits and not inverted
+ *   (i.e. what LWIP_CHKSUM(dataptr, len) returns)
+ *
+ * This allows sums precomputed for constant data (e.g. web assets) to be used
+ * instead of reading every byte. Data the hook does not know must still be
+ * summed, e.g. with (u16_t)~inet_chksum(dataptr, len).
+ */
+#ifdef __DOXYGEN__
+#define LWIP_HOOK_TCP_NOCOPY_CHKSUM(dataptr, len)
+#endif
+
 /**
  * LWIP_HOOK_IP4_INPUT(pbuf, input_netif):
  * Called from ip_input() (IPv4)
@@ -228,6 +228,14 @@ struct stats_mib2_netif_ctrs {
   u32_t ifouterrors;
 };
 
+#if TCP_STATS
+/** TCP segment events not covered by stats_proto */
+struct stats_tcp_seg {
+  STAT_COUNTER rexmit;       /* Segments retransmitted (fast or RTO). */
+  STAT_COUNTER ooseq;        /* Out-of-sequence segments received. */
+};
+#endif
+
 /** lwIP stats container */
 struct stats_ {
 #if LINK_STATS
@@ -261,6 +269,8 @@ struct stats_ {
 #if TCP_STATS
   /** TCP */
   struct stats_proto tcp;
+  /** TCP segment events */
+  struct stats_tcp_seg tcp_seg;
 #endif
 #if MEM_STATS
   /** Heap */
@@ -248,6 +248,11 @@ struct tcp_pcb {
   /* ports are in host byte order */
   u16_t remote_port;
 
+#if LWIP_TCP_PCB_HASH
+  /* next pcb in the same tcp_pcb_hash bucket */
+  struct tcp_pcb *hash_next;
+#endif /* LWIP_TCP_PCB_HASH */
+
   tcpflags_t flags;
 #define TF_ACK_DELAY   0x01U   /* Delayed ACK. */
 #define TF_ACK_NOW     0x02U   /* Immediate ACK. */
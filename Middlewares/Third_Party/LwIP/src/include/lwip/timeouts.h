@@ -98,6 +98,12 @@ struct sys_timeo {
 #if LWIP_DEBUG_TIMERNAMES
   const char* handler_name;
 #endif /* LWIP_DEBUG_TIMERNAMES */
+#if LWIP_TIMERS_WHEEL
+  /** link pointing at this entry in its wheel slot (for O(1) removal) */
+  struct sys_timeo **pprev;
+  /** next entry in the same handler/arg bucket */
+  struct sys_timeo *hash_next;
+#endif /* LWIP_TIMERS_WHEEL */
 };
 
 void sys_timeouts_init(void);
@@ -115,6 +121,9 @@ void sys_check_timeouts(void);
 u32_t sys_timeouts_sleeptime(void);
 
 #if LWIP_TESTMODE
+#if LWIP_TIMERS_WHEEL
+#error "LWIP_TESTMODE needs the timeout list: set LWIP_TIMERS_WHEEL to 0"
+#endif
 struct sys_timeo** sys_timeouts_get_next_timeout(void);
 void lwip_cyclic_timer(void *arg);
 #endif
@@ -79,6 +79,11 @@ typedef int sys_prot_t;
 
 #endif
 
+/* lwIP's static memory (pools, heap) goes to its own .bss input section so
+ * the linker script can hold it to the profile budget (lwip_profile.h) */
+#define LWIP_DECLARE_MEMORY_ALIGNED(variable_name, size) \
+  u8_t variable_name[LWIP_MEM_ALIGN_BUFFER(size)] __attribute__((section(".bss.lwip_ram." #variable_name)))
+
 #define LWIP_PLATFORM_ASSERT(x) do {printf("Assertion \"%s\" failed at line %d in %s\n", \
                                      x, __LINE__, __FILE__); } while(0)
 
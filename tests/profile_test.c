@@ -0,0 +1,120 @@
+/* tests/profile_test.c
+ *
+ * Host check of one lwIP memory profile (Core/Inc/lwip_profile.h), built
+ * once per LWIP_PROFILE by "make -C tests".
+ *
+ * Prints what the profile can hold at once (TCP pcbs, http_state slots,
+ * send buffer and window, PBUF_POOL bytes) and the RAM of every pool, sized
+ * from the same memp_std.h descriptors and formula as mem_budget.c. Then
+ * checks that:
+ *   - every pcb can get its http_state next to DHCP and two replies,
+ *   - a full receive window fits the PBUF_POOL,
+ *   - a full send buffer fits the segment pool,
+ *   - the pools fit LWIP_PROFILE_RAM_BUDGET.
+ * The last check needs the target's ILP32 struct sizes, so it only runs
+ * when built with -m32 (gcc-multilib). On an LP64 host the pcb, pbuf and
+ * timeout structs are larger than on the Cortex-M0+, and the total is
+ * printed for information only; the linker script has the final word.
+ *
+ * On-wire throughput is not covered here: see README, "Comparing Memory
+ * Profiles". Exit status 1 when a check fails.
+ */
+
+#include "lwip/opt.h"
+#include "lwip/memp.h"
+#include "lwip/sys.h"
+#include "lwip/stats.h"
+
+/* Everything memp_std.h needs for its sizes, as in memp.c */
+#include "lwip/pbuf.h"
+#include "lwip/raw.h"
+#include "lwip/udp.h"
+#include "lwip/tcp.h"
+#include "lwip/priv/tcp_priv.h"
+#include "lwip/altcp.h"
+#include "lwip/ip4_frag.h"
+#include "lwip/netbuf.h"
+#include "lwip/api.h"
+#include "lwip/priv/tcpip_priv.h"
+#include "lwip/priv/api_msg.h"
+#include "lwip/priv/sockets_priv.h"
+#include "lwip/etharp.h"
+#include "lwip/igmp.h"
+#include "lwip/timeouts.h"
+#include "netif/ppp/ppp_opts.h"
+#include "lwip/netdb.h"
+#include "lwip/dns.h"
+#include "lwip/priv/nd6_priv.h"
+#include "lwip/ip6_frag.h"
+#include "lwip/mld6.h"
+#include <stdio.h>
+
+/* mem_malloc() slots taken next to the http_states (lwip_profile.h): struct dhcp, two replies */
+#define TEST_SMALL_RESERVED 3
+
+static const struct {
+    const char *name;
+    unsigned long num;
+    unsigned long size;
+} test_pools[] = {
+#define LWIP_MEMPOOL(name,num,size,desc) { #name, (num), (size) },
+#include "lwip/priv/memp_std.h"
+};
+
+#define TEST_POOLS  (sizeof(test_pools) / sizeof(test_pools[0]))
+
+static unsigned test_failed;
+
+static void test_check(int ok, const char *what)
+{
+    printf("  %-44s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok) test_failed++;
+}
+
+int main(void)
+{
+    unsigned long total = 0;
+    unsigned i;
+
+    printf("profile %d (%s), budget %lu bytes\n", LWIP_PROFILE, LWIP_PROFILE_NAME,
+           (unsigned long)LWIP_PROFILE_RAM_BUDGET);
+
+    // 1. Static capacity
+    printf("  tcp pcbs %u (+%u listen), http_state slots %u of %u small\n",
+           (unsigned)MEMP_NUM_TCP_PCB, (unsigned)MEMP_NUM_TCP_PCB_LISTEN,
+           (unsigned)MEMP_NUM_TCP_PCB, (unsigned)LWIP_PROFILE_POOL_SMALL);
+    printf("  mss %u, snd_buf %u, wnd %u, snd_queuelen %u, segs %u\n",
+           (unsigned)TCP_MSS, (unsigned)TCP_SND_BUF, (unsigned)TCP_WND,
+           (unsigned)TCP_SND_QUEUELEN, (unsigned)MEMP_NUM_TCP_SEG);
+    printf("  pbuf pool %u x %u = %u bytes\n", (unsigned)PBUF_POOL_SIZE,
+           (unsigned)PBUF_POOL_BUFSIZE, (unsigned)(PBUF_POOL_SIZE * PBUF_POOL_BUFSIZE));
+
+    // 2. RAM per pool, as LWIP_MEMPOOL_DECLARE sizes it
+    for (i = 0; i < TEST_POOLS; i++)
+    {
+        unsigned long size = LWIP_MEM_ALIGN_SIZE(test_pools[i].size);
+        unsigned long bytes = LWIP_MEM_ALIGN_BUFFER(test_pools[i].num * (MEMP_SIZE + size));
+
+        printf("  %-16s %3lu x %4lu = %6lu\n", test_pools[i].name, test_pools[i].num, size, bytes);
+        total += bytes;
+    }
+    printf("  %-16s %19lu (%s)\n", "total", total,
+           (sizeof(void *) == 4) ? "ILP32, as on the target" : "LP64 host, larger than on the target");
+
+    // 3. Checks
+    test_check(LWIP_PROFILE_POOL_SMALL >= MEMP_NUM_TCP_PCB + TEST_SMALL_RESERVED,
+               "one http_state per pcb");
+    test_check(PBUF_POOL_SIZE * (PBUF_POOL_BUFSIZE - PBUF_LINK_HLEN - 40) >= TCP_WND,
+               "receive window fits the pbuf pool");
+    test_check(TCP_SND_QUEUELEN <= MEMP_NUM_TCP_SEG, "send queue fits the segment pool");
+    if (sizeof(void *) == 4)
+    {
+        test_check(total <= LWIP_PROFILE_RAM_BUDGET, "pools fit LWIP_PROFILE_RAM_BUDGET");
+    }
+    else
+    {
+        printf("  %-44s skipped (build with -m32)\n", "pools fit LWIP_PROFILE_RAM_BUDGET");
+    }
+
+    return test_failed ? 1 : 0;
+}